@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/constructing.dir/examples/constructing.cpp.o"
+  "CMakeFiles/constructing.dir/examples/constructing.cpp.o.d"
+  "constructing"
+  "constructing.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/constructing.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
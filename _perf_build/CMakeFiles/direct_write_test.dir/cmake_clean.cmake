@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/direct_write_test.dir/tests/direct_write_test.cpp.o"
+  "CMakeFiles/direct_write_test.dir/tests/direct_write_test.cpp.o.d"
+  "direct_write_test"
+  "direct_write_test.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/direct_write_test.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/encoder_bench.dir/benchmarks/encoder_bench.cpp.o"
+  "CMakeFiles/encoder_bench.dir/benchmarks/encoder_bench.cpp.o.d"
+  "encoder_bench"
+  "encoder_bench.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/encoder_bench.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/latency_bench.dir/benchmarks/latency_bench.cpp.o"
+  "CMakeFiles/latency_bench.dir/benchmarks/latency_bench.cpp.o.d"
+  "latency_bench"
+  "latency_bench.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/latency_bench.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/parser_bench.dir/benchmarks/parser_bench.cpp.o"
+  "CMakeFiles/parser_bench.dir/benchmarks/parser_bench.cpp.o.d"
+  "parser_bench"
+  "parser_bench.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/parser_bench.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
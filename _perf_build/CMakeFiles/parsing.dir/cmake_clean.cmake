@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/parsing.dir/examples/parsing.cpp.o"
+  "CMakeFiles/parsing.dir/examples/parsing.cpp.o.d"
+  "parsing"
+  "parsing.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/parsing.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
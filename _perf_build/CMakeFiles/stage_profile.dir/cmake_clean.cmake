@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/stage_profile.dir/benchmarks/stage_profile.cpp.o"
+  "CMakeFiles/stage_profile.dir/benchmarks/stage_profile.cpp.o.d"
+  "stage_profile"
+  "stage_profile.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/stage_profile.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/ws_generate.dir/tools/ws_generate.cpp.o"
+  "CMakeFiles/ws_generate.dir/tools/ws_generate.cpp.o.d"
+  "ws_generate"
+  "ws_generate.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/ws_generate.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
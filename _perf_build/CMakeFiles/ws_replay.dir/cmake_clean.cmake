@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/ws_replay.dir/tools/ws_replay.cpp.o"
+  "CMakeFiles/ws_replay.dir/tools/ws_replay.cpp.o.d"
+  "ws_replay"
+  "ws_replay.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/ws_replay.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,12 @@
+# CMake generated Testfile for 
+# Source directory: /root/repo
+# Build directory: /root/repo/_perf_build
+# 
+# This file includes the relevant testing commands required for 
+# testing this directory and lists subdirectories to be tested as well.
+add_test([=[arbiter_test]=] "/root/repo/_perf_build/arbiter_test")
+set_tests_properties([=[arbiter_test]=] PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/CMakeLists.txt;54;add_test;/root/repo/CMakeLists.txt;0;")
+add_test([=[capture_test]=] "/root/repo/_perf_build/capture_test")
+set_tests_properties([=[capture_test]=] PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/CMakeLists.txt;54;add_test;/root/repo/CMakeLists.txt;0;")
+add_test([=[direct_write_test]=] "/root/repo/_perf_build/direct_write_test")
+set_tests_properties([=[direct_write_test]=] PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/CMakeLists.txt;54;add_test;/root/repo/CMakeLists.txt;0;")
@@ -0,0 +1,225 @@
+#ifndef _WSFRAME_BENCHMARKS_BENCH_COMMON_HPP_
+#define _WSFRAME_BENCHMARKS_BENCH_COMMON_HPP_
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include <wsframe/perf_counters.hpp>
+#include <wsframe/wsframe.hpp>
+
+namespace bench {
+
+// Time stamp counter where available, nanoseconds otherwise. Only ever used
+// as a difference, converted with tsc_per_ns().
+inline std::uint64_t rdtsc() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+#endif
+}
+
+// rdtsc fenced so the timed region cannot drift across it
+inline std::uint64_t rdtsc_fenced() {
+#if defined(__x86_64__) || defined(__i386__)
+    _mm_lfence();
+    std::uint64_t out = __rdtsc();
+    _mm_lfence();
+    return out;
+#else
+    return rdtsc();
+#endif
+}
+
+// Ticks per nanosecond, measured against steady_clock once per process
+inline double tsc_per_ns() {
+    static const double ratio = [] {
+        auto t0 = std::chrono::steady_clock::now();
+        std::uint64_t c0 = rdtsc();
+        while (std::chrono::steady_clock::now() - t0 <
+               std::chrono::milliseconds(50)) {
+        }
+        std::uint64_t c1 = rdtsc();
+        auto t1 = std::chrono::steady_clock::now();
+        double ns =
+            std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0)
+                .count();
+        return static_cast<double>(c1 - c0) / ns;
+    }();
+    return ratio;
+}
+
+// Counts retired user space instructions of the calling thread.
+// available() is false when the kernel or the sandbox does not expose
+// hardware counters, in which case reads return 0.
+class InstructionCounter {
+  private:
+    wsframe::perf::CounterGroup m_group{wsframe::perf::Event::INSTRUCTIONS};
+    std::uint64_t m_start = 0;
+
+    std::uint64_t now() {
+        wsframe::perf::CounterGroup::Values values;
+        m_group.read(values);
+        return values[static_cast<int>(wsframe::perf::Event::INSTRUCTIONS)];
+    }
+
+  public:
+    bool available() const { return m_group.available(); }
+
+    void start() { m_start = now(); }
+
+    std::uint64_t stop() { return now() - m_start; }
+};
+
+template <typename T> inline void do_not_optimize(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+// `count` frames with `payload_size` byte payloads, back to back
+inline std::string make_stream(std::size_t payload_size, std::size_t count,
+                               bool mask) {
+    wsframe::FrameFactory factory(payload_size + 14);
+    std::string payload(payload_size, 'x');
+    std::string stream;
+    for (std::size_t i = 0; i < count; i++) {
+        stream += factory.binary(true, mask, payload);
+    }
+    return stream;
+}
+
+// One result row. Values are kept as preformatted strings so the same row
+// can be written as CSV or JSON.
+class Row {
+  private:
+    std::vector<std::pair<std::string, std::string>> m_fields;
+    std::vector<bool> m_quoted;
+
+  public:
+    Row& add(std::string key, std::string value) {
+        m_fields.emplace_back(std::move(key), std::move(value));
+        m_quoted.push_back(true);
+        return *this;
+    }
+
+    Row& add(std::string key, const char* value) {
+        return add(std::move(key), std::string(value));
+    }
+
+    template <typename T> Row& add(std::string key, T value) {
+        m_fields.emplace_back(std::move(key), std::to_string(value));
+        m_quoted.push_back(false);
+        return *this;
+    }
+
+    // JSON null / empty CSV cell, for metrics that could not be measured
+    Row& add_null(std::string key) {
+        m_fields.emplace_back(std::move(key), "");
+        m_quoted.push_back(false);
+        return *this;
+    }
+
+    Row& add(std::string key, bool value) {
+        m_fields.emplace_back(std::move(key), value ? "true" : "false");
+        m_quoted.push_back(false);
+        return *this;
+    }
+
+    const std::vector<std::pair<std::string, std::string>>& fields() const {
+        return m_fields;
+    }
+
+    bool quoted(std::size_t i) const { return m_quoted[i]; }
+};
+
+class Reporter {
+  public:
+    enum class Format { CSV, JSON };
+
+  private:
+    Format m_format;
+    std::ostream& m_out;
+    std::size_t m_rows = 0;
+    std::string m_header;
+
+  public:
+    Reporter(Format format, std::ostream& out = std::cout)
+        : m_format(format), m_out(out) {
+        if (m_format == Format::JSON)
+            m_out << "[";
+    }
+
+    ~Reporter() {
+        if (m_format == Format::JSON)
+            m_out << "\n]" << std::endl;
+    }
+
+    void write(const Row& row) {
+        const auto& fields = row.fields();
+        if (m_format == Format::CSV) {
+            // new header whenever the columns change, e.g. summary rows
+            // followed by per-sample rows
+            std::string header;
+            for (std::size_t i = 0; i < fields.size(); i++) {
+                header += (i ? "," : "") + fields[i].first;
+            }
+            if (header != m_header) {
+                m_out << (m_rows ? "\n" : "") << header << "\n";
+                m_header = header;
+            }
+            for (std::size_t i = 0; i < fields.size(); i++) {
+                m_out << (i ? "," : "") << fields[i].second;
+            }
+            m_out << std::endl;
+        } else {
+            m_out << (m_rows ? ",\n  {" : "\n  {");
+            for (std::size_t i = 0; i < fields.size(); i++) {
+                m_out << (i ? ", " : "") << "\"" << fields[i].first << "\": ";
+                if (row.quoted(i)) {
+                    m_out << "\"" << fields[i].second << "\"";
+                } else if (fields[i].second.empty()) {
+                    m_out << "null";
+                } else {
+                    m_out << fields[i].second;
+                }
+            }
+            m_out << "}" << std::flush;
+        }
+        m_rows++;
+    }
+};
+
+// --format=csv|json, defaults to csv
+inline Reporter::Format parse_format(int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        std::string_view arg(argv[i]);
+        if (arg == "--format=json")
+            return Reporter::Format::JSON;
+        if (arg == "--format=csv")
+            return Reporter::Format::CSV;
+    }
+    return Reporter::Format::CSV;
+}
+
+inline bool has_flag(int argc, char** argv, std::string_view flag) {
+    for (int i = 1; i < argc; i++) {
+        if (flag == argv[i])
+            return true;
+    }
+    return false;
+}
+
+} // namespace bench
+
+#endif // _WSFRAME_BENCHMARKS_BENCH_COMMON_HPP_
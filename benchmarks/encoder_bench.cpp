@@ -0,0 +1,183 @@
+// Cost of FrameFactory::construct and its wrappers per header length class,
+// masked and unmasked, with warm and cold (freshly allocated) buffers, plus
+// the cost of refilling the masking key cache.
+//
+//   encoder_bench [--format=csv|json] [--quick]
+
+#include "bench_common.hpp"
+
+#include <memory>
+
+namespace {
+
+using Opcode = wsframe::Frame::Opcode;
+
+const char* length_class(std::size_t payload) {
+    if (payload < 126)
+        return "7bit";
+    if (payload <= 0xFFFF)
+        return "16bit";
+    return "64bit";
+}
+
+struct Sample {
+    std::size_t frames = 0;
+    std::size_t bytes = 0;
+    std::uint64_t ticks = 0;
+    std::uint64_t instructions = 0;
+};
+
+std::string_view encode(wsframe::FrameFactory& factory, const char* op,
+                        bool mask, std::string_view payload) {
+    std::string_view name(op);
+    if (name == "text")
+        return factory.text(true, mask, payload);
+    if (name == "binary")
+        return factory.binary(true, mask, payload);
+    if (name == "ping")
+        return factory.ping(mask, payload);
+    if (name == "pong")
+        return factory.pong(mask, payload);
+    if (name == "close")
+        return factory.close(mask, payload);
+    return factory.construct(true, Opcode::BINARY, mask, payload);
+}
+
+// Same factory over and over: buffer capacity already fits
+Sample warm(const char* op, bool mask, std::string_view payload,
+            std::size_t frames, bench::InstructionCounter& counter) {
+    wsframe::FrameFactory factory;
+    encode(factory, op, mask, payload);
+    Sample sample;
+    counter.start();
+    std::uint64_t t0 = bench::rdtsc();
+    for (std::size_t i = 0; i < frames; i++) {
+        auto raw = encode(factory, op, mask, payload);
+        bench::do_not_optimize(raw.data());
+        sample.bytes += raw.size();
+    }
+    sample.ticks = bench::rdtsc() - t0;
+    sample.instructions = counter.stop();
+    sample.frames = frames;
+    return sample;
+}
+
+// One frame per freshly constructed, empty factory: every construct has to
+// grow the buffer in ensure_fit
+Sample cold(const char* op, bool mask, std::string_view payload,
+            std::size_t frames, bench::InstructionCounter& counter) {
+    std::vector<std::unique_ptr<wsframe::FrameFactory>> factories;
+    for (std::size_t i = 0; i < frames; i++) {
+        factories.push_back(std::make_unique<wsframe::FrameFactory>(0));
+    }
+    Sample sample;
+    counter.start();
+    std::uint64_t t0 = bench::rdtsc();
+    for (auto& factory : factories) {
+        auto raw = encode(*factory, op, mask, payload);
+        bench::do_not_optimize(raw.data());
+        sample.bytes += raw.size();
+    }
+    sample.ticks = bench::rdtsc() - t0;
+    sample.instructions = counter.stop();
+    sample.frames = frames;
+    return sample;
+}
+
+Sample refill(std::size_t refills, bench::InstructionCounter& counter) {
+    wsframe::FrameFactory factory;
+    Sample sample;
+    counter.start();
+    std::uint64_t t0 = bench::rdtsc();
+    for (std::size_t i = 0; i < refills; i++) {
+        factory.fill_random_cache();
+    }
+    // RandomCache<8> holds 8 four byte keys
+    sample.bytes = refills * 32;
+    sample.ticks = bench::rdtsc() - t0;
+    sample.instructions = counter.stop();
+    sample.frames = refills;
+    return sample;
+}
+
+void report(bench::Reporter& reporter, const char* op, const char* capacity,
+            std::size_t payload, const char* cls, bool mask,
+            const Sample& sample, bool have_instructions) {
+    double ns = sample.ticks / bench::tsc_per_ns();
+    bench::Row row;
+    row.add("benchmark", "encoder")
+        .add("op", op)
+        .add("capacity", capacity)
+        .add("payload", payload)
+        .add("length_class", cls)
+        .add("masked", mask)
+        .add("frames", sample.frames)
+        .add("ns_per_frame", ns / sample.frames);
+    if (sample.bytes > 0) {
+        row.add("gb_per_sec", sample.bytes / ns);
+    } else {
+        row.add_null("gb_per_sec");
+    }
+    if (have_instructions && (sample.bytes > 0)) {
+        row.add("instructions_per_byte",
+                static_cast<double>(sample.instructions) / sample.bytes);
+    } else {
+        row.add_null("instructions_per_byte");
+    }
+    reporter.write(row);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const bool quick = bench::has_flag(argc, argv, "--quick");
+    bench::Reporter reporter(bench::parse_format(argc, argv));
+    bench::InstructionCounter counter;
+    if (!counter.available()) {
+        std::cerr << "perf_event_open unavailable, instructions_per_byte "
+                     "will be empty"
+                  << std::endl;
+    }
+
+    // bytes encoded per case
+    const std::size_t budget = quick ? (8 << 20) : (256 << 20);
+    // cold factories each keep their buffer alive until the case ends
+    const std::size_t cold_budget = quick ? (4 << 20) : (64 << 20);
+    const std::size_t max_frames = quick ? 20000 : 1000000;
+
+    const std::vector<std::size_t> payloads = {0,     16,    125,     126,
+                                               1024,  65535, 65536,   1 << 20,
+                                               16 << 20};
+    for (bool mask : {false, true}) {
+        for (std::size_t payload : payloads) {
+            std::string data(payload, 'x');
+            std::size_t frames = std::max<std::size_t>(
+                1, std::min(max_frames, budget / (payload + 14)));
+            report(reporter, "construct", "warm", payload,
+                   length_class(payload), mask,
+                   warm("construct", mask, data, frames, counter),
+                   counter.available());
+            frames = std::max<std::size_t>(
+                1, std::min(max_frames, cold_budget / (payload + 114)));
+            report(reporter, "construct", "cold", payload,
+                   length_class(payload), mask,
+                   cold("construct", mask, data, frames, counter),
+                   counter.available());
+        }
+
+        // wrappers, with payloads valid for control frames
+        for (const char* op : {"text", "binary", "ping", "pong", "close"}) {
+            for (std::size_t payload : {0, 125}) {
+                std::string data(payload, 'x');
+                report(reporter, op, "warm", payload, length_class(payload),
+                       mask, warm(op, mask, data, max_frames, counter),
+                       counter.available());
+            }
+        }
+    }
+
+    // frames/bytes here are refills and the random bytes they generate
+    report(reporter, "fill_random_cache", "warm", 0, "", true,
+           refill(max_frames, counter), counter.available());
+    return 0;
+}
@@ -0,0 +1,113 @@
+#ifndef _WSFRAME_BENCHMARKS_HISTOGRAM_HPP_
+#define _WSFRAME_BENCHMARKS_HISTOGRAM_HPP_
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace bench {
+
+// HDR style log-linear histogram: values below 2^sub_bits are recorded
+// exactly, larger values keep sub_bits of precision (11 bits ~ 0.1%
+// relative error). Recording is a clz, a shift and an increment.
+class Histogram {
+  private:
+    static constexpr int sub_bits = 11;
+    static constexpr std::uint64_t sub_count = 1ULL << sub_bits;
+    static constexpr std::uint64_t half_count = sub_count >> 1;
+
+    std::vector<std::uint64_t> m_counts;
+    std::uint64_t m_total = 0;
+    std::uint64_t m_max = 0;
+
+    static std::size_t index(std::uint64_t value) {
+        if (value < sub_count)
+            return value;
+        int msb = 63 - __builtin_clzll(value);
+        int shift = msb - sub_bits + 1;
+        return (static_cast<std::size_t>(shift) << (sub_bits - 1)) +
+               (value >> shift);
+    }
+
+    // largest value that maps to `idx`
+    static std::uint64_t highest(std::size_t idx) {
+        if (idx < sub_count)
+            return idx;
+        int shift = static_cast<int>(idx >> (sub_bits - 1)) - 1;
+        std::uint64_t sub = idx - (static_cast<std::uint64_t>(shift)
+                                   << (sub_bits - 1));
+        return ((sub + 1) << shift) - 1;
+    }
+
+  public:
+    Histogram() : m_counts(index(~0ULL) + 1) {}
+
+    void record(std::uint64_t value) {
+        m_counts[index(value)]++;
+        m_total++;
+        m_max = std::max(m_max, value);
+    }
+
+    std::uint64_t count() const { return m_total; }
+
+    std::uint64_t max() const { return m_max; }
+
+    // smallest recorded value v such that `percentile`% of samples are <= v
+    std::uint64_t percentile(double percentile) const {
+        if (m_total == 0)
+            return 0;
+        auto target = static_cast<std::uint64_t>(
+            std::max(1.0, percentile / 100.0 * m_total + 0.5));
+        std::uint64_t seen = 0;
+        for (std::size_t i = 0; i < m_counts.size(); i++) {
+            seen += m_counts[i];
+            if (seen >= target)
+                return std::min(highest(i), m_max);
+        }
+        return m_max;
+    }
+};
+
+// Keeps the `capacity` largest samples along with whatever context the
+// caller attaches to them
+template <typename Context> class WorstSamples {
+  public:
+    struct Sample {
+        std::uint64_t value;
+        Context context;
+        bool operator>(const Sample& other) const {
+            return value > other.value;
+        }
+    };
+
+  private:
+    std::size_t m_capacity;
+    // min-heap on value, so the smallest kept sample is evicted first
+    std::vector<Sample> m_heap;
+
+  public:
+    WorstSamples(std::size_t capacity) : m_capacity(capacity) {}
+
+    void record(std::uint64_t value, const Context& context) {
+        if (m_heap.size() < m_capacity) {
+            m_heap.push_back({value, context});
+            std::push_heap(m_heap.begin(), m_heap.end(), std::greater<>());
+        } else if (value > m_heap.front().value) {
+            std::pop_heap(m_heap.begin(), m_heap.end(), std::greater<>());
+            m_heap.back() = {value, context};
+            std::push_heap(m_heap.begin(), m_heap.end(), std::greater<>());
+        }
+    }
+
+    // worst first
+    std::vector<Sample> sorted() const {
+        std::vector<Sample> out = m_heap;
+        std::sort(out.begin(), out.end(), std::greater<>());
+        return out;
+    }
+};
+
+} // namespace bench
+
+#endif // _WSFRAME_BENCHMARKS_HISTOGRAM_HPP_
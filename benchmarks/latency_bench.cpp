@@ -0,0 +1,203 @@
+// Per call latency of FrameParser::update and FrameFactory::construct on a
+// mixed workload, timed with fenced TSC reads and recorded into HDR style
+// histograms. Reports percentiles and the calls behind the worst samples.
+//
+//   latency_bench [--format=csv|json] [--quick]
+
+#include "bench_common.hpp"
+#include "histogram.hpp"
+
+#include <cmath>
+
+namespace {
+
+struct Context {
+    const char* op;
+    std::size_t call;
+    // parser: chunk size, factory: payload size
+    std::size_t bytes;
+    // parser only: bytes already buffered before the call
+    std::size_t buffered;
+    // parser: frame buffer capacity, factory: 0
+    std::size_t capacity_before;
+    std::size_t capacity_after;
+    bool frame_done;
+    // factory only: buffer was reallocated by ensure_fit
+    bool grew;
+    // factory only: this key emptied the RandomCache
+    bool key_refill;
+};
+
+struct Recorder {
+    const char* op;
+    bench::Histogram histogram;
+    bench::WorstSamples<Context> worst;
+
+    Recorder(const char* name, std::size_t keep) : op(name), worst(keep) {}
+
+    void record(std::uint64_t ticks, const Context& context) {
+        histogram.record(ticks);
+        worst.record(ticks, context);
+    }
+};
+
+// smallest back to back fenced rdtsc difference, subtracted from samples
+std::uint64_t timer_overhead() {
+    std::uint64_t best = ~0ULL;
+    for (int i = 0; i < 10000; i++) {
+        std::uint64_t t0 = bench::rdtsc_fenced();
+        std::uint64_t t1 = bench::rdtsc_fenced();
+        best = std::min(best, t1 - t0);
+    }
+    return best;
+}
+
+// log-uniform sizes in [lo, hi]
+std::size_t log_uniform(wsframe::XorShift128Plus& rng, std::size_t lo,
+                        std::size_t hi) {
+    double u = (rng.next64() >> 11) * (1.0 / 9007199254740992.0);
+    double lo_log = std::log(static_cast<double>(lo + 1));
+    double hi_log = std::log(static_cast<double>(hi + 1));
+    return static_cast<std::size_t>(std::exp(lo_log + u * (hi_log - lo_log))) -
+           1;
+}
+
+// mostly small frames, some 16 bit lengths, a few large ones
+std::size_t payload_size(wsframe::XorShift128Plus& rng) {
+    std::uint64_t pick = rng.next64() % 100;
+    if (pick < 80)
+        return rng.next64() % 126;
+    if (pick < 95)
+        return log_uniform(rng, 126, 0xFFFF);
+    return log_uniform(rng, 0x10000, 1 << 20);
+}
+
+double to_ns(std::uint64_t ticks) { return ticks / bench::tsc_per_ns(); }
+
+void report(bench::Reporter& reporter, const std::vector<Recorder*>& ops) {
+    for (auto* rec : ops) {
+        const auto& h = rec->histogram;
+        bench::Row row;
+        row.add("benchmark", "latency")
+            .add("op", rec->op)
+            .add("samples", h.count())
+            .add("p50_ns", to_ns(h.percentile(50)))
+            .add("p90_ns", to_ns(h.percentile(90)))
+            .add("p99_ns", to_ns(h.percentile(99)))
+            .add("p999_ns", to_ns(h.percentile(99.9)))
+            .add("p9999_ns", to_ns(h.percentile(99.99)))
+            .add("max_ns", to_ns(h.max()));
+        reporter.write(row);
+    }
+    for (auto* rec : ops) {
+        std::size_t rank = 0;
+        for (const auto& sample : rec->worst.sorted()) {
+            const Context& c = sample.context;
+            bench::Row row;
+            row.add("benchmark", "latency_worst")
+                .add("op", c.op)
+                .add("rank", rank++)
+                .add("ns", to_ns(sample.value))
+                .add("call", c.call)
+                .add("bytes", c.bytes)
+                .add("buffered", c.buffered)
+                .add("capacity_before", c.capacity_before)
+                .add("capacity_after", c.capacity_after)
+                .add("frame_done", c.frame_done)
+                .add("grew", c.grew)
+                .add("key_refill", c.key_refill);
+            reporter.write(row);
+        }
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const bool quick = bench::has_flag(argc, argv, "--quick");
+    bench::Reporter reporter(bench::parse_format(argc, argv));
+
+    const std::size_t frames = quick ? 5000 : 200000;
+    const std::size_t keep = 10;
+    const std::uint64_t overhead = timer_overhead();
+    auto sample = [&](std::uint64_t t0, std::uint64_t t1) {
+        std::uint64_t ticks = t1 - t0;
+        return ticks > overhead ? ticks - overhead : 0;
+    };
+
+    wsframe::XorShift128Plus rng(0x5eed, 0xf00d);
+    std::vector<std::size_t> sizes(frames);
+    for (auto& size : sizes) {
+        size = payload_size(rng);
+    }
+    std::string payload(1 << 20, 'x');
+
+    // encode: alternate masked and unmasked frames, collecting the stream
+    // for the parser run
+    Recorder construct("construct", keep);
+    std::string stream;
+    {
+        wsframe::BasicFrameFactory<wsframe::FactoryStats> factory;
+        const char* last = nullptr;
+        std::uint64_t refills = 0;
+        for (std::size_t i = 0; i < frames; i++) {
+            bool mask = i & 1;
+            std::string_view data(payload.data(), sizes[i]);
+            std::uint64_t t0 = bench::rdtsc_fenced();
+            auto raw = factory.construct(true, wsframe::Frame::Opcode::BINARY,
+                                         mask, data);
+            std::uint64_t t1 = bench::rdtsc_fenced();
+            Context c{"construct", i, sizes[i], 0, 0, 0, true, false, false};
+            c.grew = (last != nullptr) && (raw.data() != last);
+            std::uint64_t now = factory.hooks().snapshot().key_refills;
+            c.key_refill = now != refills;
+            refills = now;
+            construct.record(sample(t0, t1), c);
+            last = raw.data();
+            stream += raw;
+        }
+    }
+
+    // decode the same stream in log-uniform chunks of 1 byte to 64 KB
+    Recorder update("update", keep);
+    {
+        wsframe::FrameParser parser;
+        auto& buf = parser.frame_buffer();
+        std::size_t call = 0;
+        std::size_t parsed = 0;
+        std::size_t off = 0;
+        while (off < stream.size()) {
+            std::size_t chunk = std::min(log_uniform(rng, 1, 1 << 16),
+                                         stream.size() - off);
+            std::string_view view(stream.data() + off, chunk);
+            off += chunk;
+            Context c{"update", call++, chunk, buf.size(), buf.capacity(),
+                      0, false, false, false};
+            std::uint64_t t0 = bench::rdtsc_fenced();
+            auto frame = parser.update(view);
+            std::uint64_t t1 = bench::rdtsc_fenced();
+            c.capacity_after = buf.capacity();
+            c.frame_done = frame.has_value();
+            update.record(sample(t0, t1), c);
+            while (frame.has_value()) {
+                parsed++;
+                Context d{"update", call++, 0, buf.size(), buf.capacity(),
+                          0, false, false, false};
+                t0 = bench::rdtsc_fenced();
+                frame = parser.update(false);
+                t1 = bench::rdtsc_fenced();
+                d.capacity_after = buf.capacity();
+                d.frame_done = frame.has_value();
+                update.record(sample(t0, t1), d);
+            }
+        }
+        if (parsed != frames) {
+            std::cerr << "parsed " << parsed << " of " << frames << " frames"
+                      << std::endl;
+            return 1;
+        }
+    }
+
+    report(reporter, {&update, &construct});
+    return 0;
+}
@@ -0,0 +1,280 @@
+// Throughput of FrameParser::update (and parse_batch) over pre-generated
+// streams, delivered in chunks of varying size.
+//
+//   parser_bench [--format=csv|json] [--quick]
+
+#include "bench_common.hpp"
+
+#include <wsframe/generator.hpp>
+#include <wsframe/scanner.hpp>
+
+#include <algorithm>
+#include <array>
+
+namespace {
+
+struct Result {
+    std::size_t frames = 0;
+    std::size_t payload_bytes = 0;
+};
+
+Result feed(wsframe::FrameParser& parser, std::string_view stream,
+            std::size_t chunk) {
+    Result result;
+    for (std::size_t off = 0; off < stream.size(); off += chunk) {
+        auto frame = parser.update(stream.substr(off, chunk));
+        while (frame.has_value()) {
+            result.frames++;
+            result.payload_bytes += frame->payload.size();
+            bench::do_not_optimize(frame->payload.data());
+            frame = parser.update(false);
+        }
+    }
+    return result;
+}
+
+// as feed, checking every frame against the generator's expectation
+bool feed_checked(wsframe::FrameParser& parser, std::string_view stream,
+                  std::size_t chunk,
+                  const std::vector<wsframe::ExpectedFrame>& expected) {
+    std::size_t frames = 0;
+    for (std::size_t off = 0; off < stream.size(); off += chunk) {
+        auto frame = parser.update(stream.substr(off, chunk));
+        while (frame.has_value()) {
+            if ((frames >= expected.size()) ||
+                !expected[frames].matches(*frame))
+                return false;
+            frames++;
+            bench::do_not_optimize(frame->payload.data());
+            frame = parser.update(false);
+        }
+    }
+    return frames == expected.size();
+}
+
+// as feed_checked, through parse_batch
+bool batch_checked(wsframe::FrameParser& parser, std::string_view stream,
+                   std::size_t chunk,
+                   const std::vector<wsframe::ExpectedFrame>& expected) {
+    std::array<wsframe::FrameDescriptor, 256> batch;
+    std::size_t frames = 0;
+    for (std::size_t off = 0; off < stream.size(); off += chunk) {
+        std::string_view data = stream.substr(off, chunk);
+        std::size_t n;
+        while ((n = parser.parse_batch(data, batch.data(), batch.size())) >
+               0) {
+            for (std::size_t i = 0; i < n; i++) {
+                const auto& frame = batch[i];
+                if ((frames >= expected.size()) ||
+                    (frame.first_byte != expected[frames].first_byte) ||
+                    (frame.length != expected[frames].payload_size))
+                    return false;
+                frames++;
+                bench::do_not_optimize(parser.payload(frame).data());
+            }
+            data = {};
+        }
+    }
+    return frames == expected.size();
+}
+
+// bursts of 20-60 byte unmasked frames, as sent by market data feeds
+std::string make_tiny_stream(std::size_t bytes) {
+    wsframe::FrameFactory factory;
+    wsframe::XorShift128Plus random(1, 2);
+    std::string payload(58, 'x');
+    std::string out;
+    while (out.size() < bytes) {
+        std::size_t size = 18 + random.next64() % 41;
+        out.append(factory.binary(true, false,
+                                  std::string_view(payload).substr(0, size)));
+    }
+    return out;
+}
+
+// frames found by scan_frames, whose output table is `batch`
+template <std::size_t N>
+std::size_t scan(std::string_view stream,
+                 std::array<wsframe::FrameDescriptor, N>& batch) {
+    std::size_t frames = 0;
+    while (!stream.empty()) {
+        auto result = wsframe::scan_frames(stream, batch.data(), batch.size());
+        if (result.frames == 0)
+            break;
+        bench::do_not_optimize(batch[result.frames - 1].offset);
+        frames += result.frames;
+        stream.remove_prefix(result.consumed);
+    }
+    return frames;
+}
+
+// frames found by parse_batch fed the whole stream
+template <std::size_t N>
+std::size_t batch(wsframe::FrameParser& parser, std::string_view stream,
+                  std::array<wsframe::FrameDescriptor, N>& batch) {
+    std::size_t frames = 0;
+    std::size_t n;
+    while ((n = parser.parse_batch(stream, batch.data(), batch.size())) > 0) {
+        bench::do_not_optimize(batch[n - 1].offset);
+        frames += n;
+        stream = {};
+    }
+    return frames;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const bool quick = bench::has_flag(argc, argv, "--quick");
+    bench::Reporter reporter(bench::parse_format(argc, argv));
+
+    const std::size_t whole = 0;
+    const std::vector<std::size_t> chunks = {1, 1460, 65536, whole};
+    const std::vector<std::size_t> payloads = {
+        0, 16, 125, 126, 1024, 65535, 65536, 1 << 20, 16 << 20};
+    // bytes fed per iteration; 1 byte chunks get a much smaller budget
+    const std::size_t budget = quick ? (4 << 20) : (64 << 20);
+    const std::size_t tiny_budget = quick ? (64 << 10) : (1 << 20);
+    // bounds the stream length for tiny frames
+    const std::size_t max_frames = 1 << 16;
+    const double min_seconds = quick ? 0.05 : 0.5;
+
+    for (bool mask : {false, true}) {
+        for (std::size_t payload : payloads) {
+            for (std::size_t chunk : chunks) {
+                std::size_t frame_size = payload + 14;
+                std::size_t target = (chunk == 1) ? tiny_budget : budget;
+                std::size_t count = std::clamp<std::size_t>(
+                    target / frame_size, 1, max_frames);
+                std::string stream = bench::make_stream(payload, count, mask);
+                std::size_t step = (chunk == whole) ? stream.size() : chunk;
+
+                wsframe::FrameParser parser;
+                feed(parser, stream, step); // warm up buffers
+
+                std::size_t iterations = 0;
+                std::size_t frames = 0;
+                std::uint64_t ticks = 0;
+                auto start = std::chrono::steady_clock::now();
+                double elapsed = 0;
+                while (elapsed < min_seconds) {
+                    std::uint64_t t0 = bench::rdtsc();
+                    Result result = feed(parser, stream, step);
+                    ticks += bench::rdtsc() - t0;
+                    if ((result.frames != count) ||
+                        (result.payload_bytes != count * payload)) {
+                        std::cerr << "parsed " << result.frames << " of "
+                                  << count << " frames" << std::endl;
+                        return 1;
+                    }
+                    frames += result.frames;
+                    iterations++;
+                    elapsed = std::chrono::duration<double>(
+                                  std::chrono::steady_clock::now() - start)
+                                  .count();
+                }
+
+                double seconds = ticks / bench::tsc_per_ns() * 1e-9;
+                double bytes = static_cast<double>(stream.size()) * iterations;
+                bench::Row row;
+                row.add("benchmark", "parser")
+                    .add("chunk", chunk == whole ? std::string("whole")
+                                                 : std::to_string(chunk))
+                    .add("payload", payload)
+                    .add("masked", mask)
+                    .add("frames", frames)
+                    .add("seconds", seconds)
+                    .add("frames_per_sec", frames / seconds)
+                    .add("gb_per_sec", bytes / seconds * 1e-9)
+                    .add("ticks_per_frame",
+                         static_cast<double>(ticks) / frames);
+                reporter.write(row);
+            }
+        }
+    }
+
+    // generated traffic: Zipf sizes, fragments, control frames, half masked
+    wsframe::GeneratorConfig config;
+    config.mask_ratio = 0.5;
+    std::string mixed;
+    std::vector<wsframe::ExpectedFrame> expected;
+    wsframe::generate(config, quick ? (1 << 20) : (16 << 20), 1, mixed,
+                      &expected);
+    for (bool batch : {false, true}) {
+        for (std::size_t chunk : {std::size_t(1460), std::size_t(65536)}) {
+            wsframe::FrameParser parser;
+            std::size_t iterations = 0;
+            std::uint64_t ticks = 0;
+            auto start = std::chrono::steady_clock::now();
+            double elapsed = 0;
+            while (elapsed < min_seconds) {
+                std::uint64_t t0 = bench::rdtsc();
+                bool ok = batch ? batch_checked(parser, mixed, chunk, expected)
+                                : feed_checked(parser, mixed, chunk, expected);
+                ticks += bench::rdtsc() - t0;
+                if (!ok) {
+                    std::cerr << "mixed stream mismatch" << std::endl;
+                    return 1;
+                }
+                iterations++;
+                elapsed = std::chrono::duration<double>(
+                              std::chrono::steady_clock::now() - start)
+                              .count();
+            }
+
+            double seconds = ticks / bench::tsc_per_ns() * 1e-9;
+            double frames = static_cast<double>(expected.size()) * iterations;
+            double bytes = static_cast<double>(mixed.size()) * iterations;
+            bench::Row row;
+            row.add("benchmark", batch ? "parser_batch" : "parser_mixed")
+                .add("chunk", chunk)
+                .add("frames", static_cast<std::size_t>(frames))
+                .add("seconds", seconds)
+                .add("frames_per_sec", frames / seconds)
+                .add("gb_per_sec", bytes / seconds * 1e-9)
+                .add("ticks_per_frame", ticks / frames);
+            reporter.write(row);
+        }
+    }
+
+    // tiny frames: boundary scanner against parse_batch, over a burst of
+    // about a thousand frames that is still in cache after the recv
+    std::string tiny = make_tiny_stream(32 << 10);
+    std::array<wsframe::FrameDescriptor, 4096> table;
+    const std::size_t tiny_frames = scan(tiny, table);
+    for (bool scanner : {true, false}) {
+        wsframe::FrameParser parser;
+        std::size_t iterations = 0;
+        std::uint64_t ticks = 0;
+        auto start = std::chrono::steady_clock::now();
+        double elapsed = 0;
+        while (elapsed < min_seconds) {
+            std::uint64_t t0 = bench::rdtsc();
+            std::size_t frames =
+                scanner ? scan(tiny, table) : batch(parser, tiny, table);
+            ticks += bench::rdtsc() - t0;
+            if (frames != tiny_frames) {
+                std::cerr << "tiny stream mismatch" << std::endl;
+                return 1;
+            }
+            iterations++;
+            elapsed = std::chrono::duration<double>(
+                          std::chrono::steady_clock::now() - start)
+                          .count();
+        }
+
+        double seconds = ticks / bench::tsc_per_ns() * 1e-9;
+        double frames = static_cast<double>(tiny_frames) * iterations;
+        double bytes = static_cast<double>(tiny.size()) * iterations;
+        bench::Row row;
+        row.add("benchmark", scanner ? "scan_tiny" : "parser_batch_tiny")
+            .add("chunk", std::string("whole"))
+            .add("frames", static_cast<std::size_t>(frames))
+            .add("seconds", seconds)
+            .add("frames_per_sec", frames / seconds)
+            .add("gb_per_sec", bytes / seconds * 1e-9)
+            .add("ticks_per_frame", ticks / frames);
+        reporter.write(row);
+    }
+    return 0;
+}
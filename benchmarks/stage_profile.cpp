@@ -0,0 +1,59 @@
+// Hardware counters per parse stage and per encoded header size on mixed
+// traffic, using the built-in WSFRAME_PERF_COUNTERS instrumentation. Shows
+// whether the staged check_* chain is branch-miss bound.
+//
+//   stage_profile [--quick]
+
+#ifndef WSFRAME_PERF_COUNTERS
+#define WSFRAME_PERF_COUNTERS
+#endif
+
+#include "bench_common.hpp"
+
+int main(int argc, char** argv) {
+    const bool quick = bench::has_flag(argc, argv, "--quick");
+    const std::size_t frames = quick ? 20000 : 1000000;
+    // frames average about 10 KB: generate up to 64 MB of them and replay
+    // the stream until `frames` were parsed
+    const std::size_t max_stream = 64 << 20;
+
+    // mixed sizes and masking so neither the length nor the masking key
+    // branches are predictable
+    wsframe::XorShift128Plus rng(0x5eed, 0xf00d);
+    std::string payload(1 << 17, 'x');
+    wsframe::FrameFactory factory;
+    std::string stream;
+    std::size_t stream_frames = 0;
+    for (; (stream_frames < frames) && (stream.size() < max_stream);
+         stream_frames++) {
+        std::uint64_t pick = rng.next64();
+        std::size_t size = (pick % 10 < 7)   ? (pick >> 8) % 126
+                           : (pick % 10 < 9) ? 126 + (pick >> 8) % 4000
+                                             : 0x10000 + (pick >> 8) % 0x10000;
+        bool mask = (pick >> 4) & 1;
+        stream += factory.construct(true, wsframe::Frame::Opcode::BINARY, mask,
+                                    std::string_view(payload.data(), size));
+    }
+
+    // decode in MTU sized chunks
+    wsframe::FrameParser parser;
+    std::size_t parsed = 0;
+    for (std::size_t pass = 1; parsed < frames; pass++) {
+        for (std::size_t off = 0; off < stream.size(); off += 1460) {
+            auto frame =
+                parser.update(std::string_view(stream).substr(off, 1460));
+            while (frame.has_value()) {
+                parsed++;
+                frame = parser.update(false);
+            }
+        }
+        if (parsed != pass * stream_frames) {
+            std::cerr << "parsed " << parsed << " of " << pass * stream_frames
+                      << " frames" << std::endl;
+            return 1;
+        }
+    }
+
+    wsframe::perf::profile().report(std::cout);
+    return 0;
+}
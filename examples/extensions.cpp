@@ -0,0 +1,87 @@
+#include <iostream>
+#include <wsframe/wsframe.hpp>
+
+// Toy application cipher: XOR every byte with a fixed key. Length preserving,
+// so the pipeline can run it in place.
+class XorCipher : public wsframe::Extension {
+  private:
+    std::uint8_t m_key;
+
+  public:
+    XorCipher(std::uint8_t key) : m_key(key) {}
+
+    std::uint8_t rsv_bits() const override { return RSV2; }
+
+    bool in_place() const override { return true; }
+
+    void encode_in_place(std::uint8_t* data, std::size_t len) override {
+        for (std::size_t i = 0; i < len; i++) {
+            data[i] ^= m_key;
+        }
+    }
+
+    void decode_in_place(std::uint8_t* data, std::size_t len) override {
+        encode_in_place(data, len);
+    }
+};
+
+// Appends a 4 byte FNV-1a checksum on the way out, verifies and strips it on
+// the way in.
+class Checksum : public wsframe::Extension {
+  private:
+    static std::uint32_t fnv1a(std::string_view data) {
+        std::uint32_t hash = 2166136261U;
+        for (char c : data) {
+            hash = (hash ^ static_cast<std::uint8_t>(c)) * 16777619U;
+        }
+        return hash;
+    }
+
+  public:
+    std::uint8_t rsv_bits() const override { return RSV3; }
+
+    std::string_view encode(std::string_view in,
+                            wsframe::FrameBuffer& out) override {
+        std::uint32_t hash = fnv1a(in);
+        out.push_back(in);
+        out.push_back(std::string_view((const char*)&hash, sizeof(hash)));
+        return out.view<std::string_view>();
+    }
+
+    std::string_view decode(std::string_view in,
+                            wsframe::FrameBuffer& /*out*/) override {
+        if (in.size() < 4) {
+            throw std::runtime_error("Payload too short for checksum");
+        }
+        std::string_view data = in.substr(0, in.size() - 4);
+        std::uint32_t hash = fnv1a(data);
+        if (std::memcmp(&hash, in.data() + data.size(), 4) != 0) {
+            throw std::runtime_error("Checksum mismatch");
+        }
+        return data;
+    }
+};
+
+int main() {
+    XorCipher cipher(0x5A);
+    Checksum checksum;
+
+    wsframe::ExtensionPipeline extensions;
+    extensions.add(checksum);
+    extensions.add(cipher);
+
+    wsframe::FrameFactory factory;
+    std::string_view raw =
+        factory.text(/*fin=*/true, /*mask=*/true, "Hello World", extensions);
+
+    wsframe::FrameParser parser;
+    auto frame = parser.update(raw);
+    if (!frame.has_value()) {
+        std::cout << "Failed to parse frame" << std::endl;
+        return 1;
+    }
+    std::cout << "Parsed " << frame.value() << std::endl;
+    std::cout << "Decoded payload: " << extensions.decode(frame.value())
+              << std::endl;
+    return 0;
+}
@@ -0,0 +1,286 @@
+#ifndef _WSFRAME_ARBITER_HPP_
+#define _WSFRAME_ARBITER_HPP_
+
+// Arbitration between redundant copies of one feed (A/B lines): the same
+// messages arrive over several connections, each parsed by its own
+// FrameParser, possibly on its own thread, and whichever copy of a message
+// arrives first is processed while the later copies are dropped.
+//
+// Messages are identified by a 64 bit key, by default a hash of the
+// payload. Recently seen keys are kept in a lock-free hash table: a line
+// claims a key with a compare-and-swap, so exactly one line wins each key
+// as long as the key is still in the table when the later copies arrive.
+// Each bucket keeps its most recent keys only; size the table well above
+// the number of messages received within the largest delay between lines.
+//
+// Per line, the arbiter counts the frames it won and lost, how far behind
+// the winner its lost copies arrived and, for the frames it won, how far
+// ahead of the other lines it was.
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string_view>
+#include <utility>
+
+#include "wsframe.hpp"
+
+namespace wsframe {
+
+// Default arbitration key: a 64 bit hash of the (unmasked) payload
+struct PayloadHash {
+    static std::uint64_t mix(std::uint64_t h) {
+        h ^= h >> 33;
+        h *= 0xFF51AFD7ED558CCDULL;
+        h ^= h >> 33;
+        h *= 0xC4CEB9FE1A85EC53ULL;
+        h ^= h >> 33;
+        return h;
+    }
+
+    // continue hashing `h` over the whole words of `data`
+    static std::uint64_t words(std::uint64_t h, const std::uint8_t* data,
+                               std::size_t size) {
+        for (std::size_t i = 0; i + 8 <= size; i += 8) {
+            std::uint64_t word;
+            std::memcpy(&word, data + i, 8);
+            h = (h ^ word) * 0x9E3779B97F4A7C15ULL;
+            h ^= h >> 29;
+        }
+        return h;
+    }
+
+    // hash the rest of the payload, `data`, and finish
+    static std::uint64_t finish(std::uint64_t h, const std::uint8_t* data,
+                                std::size_t size) {
+        h = words(h, data, size);
+        std::uint64_t tail = 0;
+        if (size % 8)
+            std::memcpy(&tail, data + (size & ~std::size_t(7)), size % 8);
+        return mix((h ^ tail) * 0x9E3779B97F4A7C15ULL);
+    }
+
+    std::uint64_t operator()(const Frame& frame) const {
+        auto* data = reinterpret_cast<const std::uint8_t*>(frame.payload.data());
+        std::size_t size = frame.payload.size();
+        std::uint64_t h = size;
+        if (!frame.mask)
+            return finish(h, data, size);
+        // unmask a block at a time, blocks being whole words
+        std::array<std::uint8_t, 256> block;
+        std::size_t done = 0;
+        for (; size - done > block.size(); done += block.size()) {
+            apply_mask(block.data(), data + done, block.size(),
+                       frame.masking_key, done % 4);
+            h = words(h, block.data(), block.size());
+        }
+        apply_mask(block.data(), data + done, size - done, frame.masking_key,
+                   done % 4);
+        return finish(h, block.data(), size - done);
+    }
+};
+
+template <typename KeyFn = PayloadHash> class FeedArbiter {
+  public:
+    static constexpr std::size_t MAX_LINES = 8;
+
+    struct LineStats {
+        // data frames offered, first arrivals among them, later copies
+        std::uint64_t frames = 0;
+        std::uint64_t wins = 0;
+        std::uint64_t losses = 0;
+        // for lost frames: sum and maximum of the delay behind the winner
+        std::uint64_t lag_total = 0;
+        std::uint64_t lag_max = 0;
+        // for won frames: sum of the delays of the other lines' copies
+        std::uint64_t lead_total = 0;
+
+        double mean_lag() const {
+            return losses ? static_cast<double>(lag_total) / losses : 0;
+        }
+    };
+
+  private:
+    // Recent keys are kept in buckets of WAYS, each a FIFO: `hand` counts
+    // the insertions, and insertion n claims way n % WAYS with a
+    // compare-and-swap. Because every line inserts at the position the hand
+    // points to, two lines racing with the same key compete for the same
+    // way and exactly one of them wins it. A way's low 8 bits hold the lap
+    // (n / WAYS + 1) it was written in, so a line that read a stale hand
+    // cannot overwrite a key inserted in the current lap; a line that finds
+    // its way taken advances the hand on behalf of the winner.
+    static constexpr std::size_t WAYS = 7;
+    static constexpr std::uint64_t LAP_MASK = 0xFF;
+    // arrival times are kept and compared modulo 2^52
+    static constexpr unsigned TIME_BITS = 52;
+    static constexpr std::uint64_t TIME_MASK =
+        (std::uint64_t(1) << TIME_BITS) - 1;
+
+    struct alignas(64) Bucket {
+        std::atomic<std::uint64_t> hand{0};
+        std::array<std::atomic<std::uint64_t>, WAYS> keys{};
+    };
+
+    // one cache line per line: counters written by its own thread only,
+    // apart from lead_total
+    struct alignas(64) Line {
+        StatCounter frames;
+        StatCounter wins;
+        StatCounter losses;
+        StatCounter lag_total;
+        StatCounter lag_max;
+        std::atomic<std::uint64_t> lead_total{0};
+    };
+
+    std::size_t m_lines;
+    std::size_t m_mask;
+    std::unique_ptr<Bucket[]> m_buckets;
+    // (arrival time mod 2^52) << 12 | 1 << 11 | lap << 3 | line of the first
+    // copy of each key, written by the line that won the way after its
+    // compare-and-swap. Until then the way holds the evicted key's info,
+    // which readers tell apart by its lap.
+    std::unique_ptr<std::atomic<std::uint64_t>[]> m_info;
+    std::array<Line, MAX_LINES> m_stats;
+    KeyFn m_key;
+
+    static std::uint64_t pack(std::uint64_t time, std::uint64_t lap,
+                              std::size_t line) {
+        return ((time & TIME_MASK) << 12) | (std::uint64_t(1) << 11) |
+               (lap << 3) | line;
+    }
+
+    // `info` of a way found holding the key with lap `lap`
+    void lost(std::size_t line, std::uint64_t time, std::uint64_t lap,
+              std::uint64_t info) {
+        Line& stats = m_stats[line];
+        stats.losses.add(1);
+        // not published yet: the arrival time is unknown
+        if (((info & 0xFFF) >> 3) != (0x100 | lap))
+            return;
+        // difference modulo 2^52, negative (this copy's clock is behind
+        // the winner's) in the upper half
+        std::uint64_t lag = (time - (info >> 12)) & TIME_MASK;
+        if (lag >> (TIME_BITS - 1))
+            lag = 0;
+        stats.lag_total.add(lag);
+        stats.lag_max.set_max(lag);
+        m_stats[info & 7].lead_total.fetch_add(lag, std::memory_order_relaxed);
+    }
+
+  public:
+    // `lines` connections carrying the same feed; room for about
+    // `capacity` recent keys
+    FeedArbiter(std::size_t lines, std::size_t capacity = 1 << 16,
+                KeyFn key = KeyFn())
+        : m_lines(lines), m_key(std::move(key)) {
+        if ((lines == 0) || (lines > MAX_LINES))
+            throw std::runtime_error("FeedArbiter: 1 to 8 lines supported");
+        std::size_t buckets = 1;
+        while (buckets * WAYS < capacity) {
+            buckets *= 2;
+        }
+        m_mask = buckets - 1;
+        m_buckets.reset(new Bucket[buckets]);
+        m_info.reset(new std::atomic<std::uint64_t>[buckets * WAYS]);
+        for (std::size_t i = 0; i < buckets * WAYS; i++) {
+            m_info[i].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    std::size_t lines() const { return m_lines; }
+
+    // Record the arrival of a message with `key` on `line` at `time` (any
+    // clock shared by the lines, e.g. Frame::last_byte_time; lags are
+    // computed modulo 2^52, so the copies of a message must arrive less than
+    // 2^51 ticks apart). Returns true for the first copy, which the caller
+    // should process. Thread safe for concurrent calls from different
+    // lines.
+    bool offer_key(std::size_t line, std::uint64_t key, std::uint64_t time) {
+        m_stats[line].frames.add(1);
+        std::uint64_t hash = PayloadHash::mix(key);
+        std::size_t index = hash & m_mask;
+        Bucket& bucket = m_buckets[index];
+        std::atomic<std::uint64_t>* info = &m_info[index * WAYS];
+        // the lap takes the low bits; 0 marks an empty way
+        key = hash & ~LAP_MASK;
+        key = key ? key : LAP_MASK + 1;
+        for (;;) {
+            std::uint64_t hand = bucket.hand.load(std::memory_order_acquire);
+            for (std::size_t i = 0; i < WAYS; i++) {
+                std::uint64_t seen =
+                    bucket.keys[i].load(std::memory_order_acquire);
+                if ((seen & ~LAP_MASK) == key) {
+                    lost(line, time, seen & LAP_MASK,
+                         info[i].load(std::memory_order_acquire));
+                    return false;
+                }
+            }
+            std::size_t way = hand % WAYS;
+            std::uint64_t lap = hand / WAYS;
+            std::uint64_t seen =
+                bucket.keys[way].load(std::memory_order_acquire);
+            // free in this lap if written in the previous one
+            if ((seen & LAP_MASK) == (lap & LAP_MASK)) {
+                std::uint64_t tag = (lap + 1) & LAP_MASK;
+                // only the winner writes the way's info
+                if (bucket.keys[way].compare_exchange_strong(
+                        seen, key | tag, std::memory_order_acq_rel)) {
+                    info[way].store(pack(time, tag, line),
+                                    std::memory_order_release);
+                    bucket.hand.compare_exchange_strong(
+                        hand, hand + 1, std::memory_order_acq_rel);
+                    m_stats[line].wins.add(1);
+                    return true;
+                }
+            }
+            // the way was taken in this lap (possibly with this key), or
+            // the hand moved on: help it along and look again
+            bucket.hand.compare_exchange_strong(hand, hand + 1,
+                                                std::memory_order_acq_rel);
+        }
+    }
+
+    // As offer_key, keyed by the key extractor
+    bool offer(std::size_t line, const Frame& frame, std::uint64_t time) {
+        return offer_key(line, m_key(frame), time);
+    }
+
+    // Parse `chunk` received on `line` at `time` with that line's parser
+    // and call on_frame(const Frame&, line) for every first copy of a data
+    // frame and for every control frame (those belong to the connection).
+    // Returns the number of calls.
+    template <typename Parser, typename F>
+    std::size_t feed(std::size_t line, Parser& parser, std::string_view chunk,
+                     std::uint64_t time, F&& on_frame) {
+        std::size_t out = 0;
+        auto frame = parser.update(chunk, time);
+        while (frame.has_value()) {
+            bool control = static_cast<std::uint8_t>(frame->opcode) & 0x08;
+            if (control || offer(line, *frame, time)) {
+                on_frame(static_cast<const Frame&>(*frame), line);
+                out++;
+            }
+            frame = parser.update(false, time);
+        }
+        return out;
+    }
+
+    LineStats stats(std::size_t line) const {
+        const Line& stats = m_stats[line];
+        LineStats out;
+        out.frames = stats.frames.load();
+        out.wins = stats.wins.load();
+        out.losses = stats.losses.load();
+        out.lag_total = stats.lag_total.load();
+        out.lag_max = stats.lag_max.load();
+        out.lead_total = stats.lead_total.load(std::memory_order_relaxed);
+        return out;
+    }
+};
+
+} // namespace wsframe
+
+#endif // _WSFRAME_ARBITER_HPP_
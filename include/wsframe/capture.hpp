@@ -0,0 +1,370 @@
+#ifndef _WSFRAME_CAPTURE_HPP_
+#define _WSFRAME_CAPTURE_HPP_
+
+// Indexed capture of raw WebSocket byte streams.
+//
+// A capture is two files:
+//   <prefix>.wscap  the raw stream, byte for byte as received
+//   <prefix>.wsidx  IndexHeader followed by IndexEntry records (host byte
+//                   order), one for the first frame starting at least
+//                   `interval` bytes after the previously indexed one
+//
+// Index entries always point at a frame header, so any entry is a valid
+// place to start a FrameParser. Timestamps must not decrease while writing;
+// seeking is then a binary search over the mapped index, and a capture can
+// be split into byte ranges that separate threads replay in parallel.
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "mapped_file.hpp"
+#include "wsframe.hpp"
+
+namespace wsframe {
+
+class Capture {
+  public:
+    struct IndexHeader {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t entry_size;
+        std::uint64_t interval;
+        std::uint8_t reserved[40];
+    };
+    static_assert(sizeof(IndexHeader) == 64, "");
+
+    struct IndexEntry {
+        // offset of the frame header in the .wscap file
+        std::uint64_t offset;
+        std::uint64_t timestamp;
+        // number of frames before this one in the capture
+        std::uint64_t frame_number;
+        // first header byte: fin, rsv and opcode
+        std::uint8_t first_byte;
+        std::uint8_t reserved[7];
+
+        Frame::Opcode opcode() const {
+            return static_cast<Frame::Opcode>(first_byte & 0x0F);
+        }
+    };
+    static_assert(sizeof(IndexEntry) == 32, "");
+
+    static constexpr char MAGIC[8] = {'W', 'S', 'C', 'A', 'P', 'I', 0, 1};
+    static constexpr std::uint32_t VERSION = 1;
+
+    static std::string data_path(const std::string& prefix) {
+        return prefix + ".wscap";
+    }
+
+    static std::string index_path(const std::string& prefix) {
+        return prefix + ".wsidx";
+    }
+};
+
+// Appends received chunks to the capture while following frame boundaries
+// (headers may straddle chunks) to build the index.
+class CaptureWriter {
+  private:
+    std::FILE* m_data = nullptr;
+    std::FILE* m_index = nullptr;
+    std::uint64_t m_interval;
+
+    std::uint64_t m_offset = 0;
+    std::uint64_t m_frames = 0;
+    // payload bytes of the current frame still to come
+    std::uint64_t m_skip = 0;
+    // header of the next frame, collected across chunks
+    std::array<std::uint8_t, Frame::MAX_HEADER_SIZE> m_header;
+    std::size_t m_header_have = 0;
+    std::uint64_t m_header_offset = 0;
+    std::uint64_t m_header_time = 0;
+    bool m_indexed_any = false;
+    std::uint64_t m_last_indexed = 0;
+
+    static std::FILE* open(const std::string& path) {
+        std::FILE* file = std::fopen(path.c_str(), "wb");
+        if (!file) {
+            throw std::runtime_error("Failed to create " + path + ": " +
+                                     std::strerror(errno));
+        }
+        std::setvbuf(file, nullptr, _IOFBF, 1 << 20);
+        return file;
+    }
+
+    void write(std::FILE* file, const void* data, std::size_t size) {
+        if (std::fwrite(data, 1, size, file) != size) {
+            throw std::runtime_error(std::string("Capture write failed: ") +
+                                     std::strerror(errno));
+        }
+    }
+
+    // a complete header for the frame at m_header_offset is in m_header
+    void header_done() {
+        std::uint64_t payload_len = m_header[1] & 0x7F;
+        if (payload_len == 126) {
+            payload_len = (std::uint64_t(m_header[2]) << 8) | m_header[3];
+        } else if (payload_len == 127) {
+            payload_len = 0;
+            for (int i = 0; i < 8; i++) {
+                payload_len = (payload_len << 8) | m_header[2 + i];
+            }
+        }
+        if (!m_indexed_any || (m_header_offset - m_last_indexed >= m_interval)) {
+            Capture::IndexEntry entry{};
+            entry.offset = m_header_offset;
+            entry.timestamp = m_header_time;
+            entry.frame_number = m_frames;
+            entry.first_byte = m_header[0];
+            write(m_index, &entry, sizeof(entry));
+            m_indexed_any = true;
+            m_last_indexed = m_header_offset;
+        }
+        m_frames++;
+        m_skip = payload_len;
+        m_header_have = 0;
+    }
+
+    void scan(const std::uint8_t* data, std::size_t size,
+              std::uint64_t time) {
+        std::size_t pos = 0;
+        while (pos < size) {
+            if (m_skip > 0) {
+                auto n = static_cast<std::size_t>(
+                    std::min<std::uint64_t>(m_skip, size - pos));
+                m_skip -= n;
+                pos += n;
+                continue;
+            }
+            if (m_header_have == 0) {
+                m_header_offset = m_offset + pos;
+                m_header_time = time;
+            }
+            std::size_t need = (m_header_have < 2)
+                                   ? 2
+                                   : Frame::header_size(m_header[1]);
+            std::size_t n = std::min(need - m_header_have, size - pos);
+            std::memcpy(m_header.data() + m_header_have, data + pos, n);
+            m_header_have += n;
+            pos += n;
+            if ((m_header_have >= 2) &&
+                (m_header_have == Frame::header_size(m_header[1])))
+                header_done();
+        }
+    }
+
+  public:
+    // An index entry is written at most every `interval` bytes of stream
+    CaptureWriter(const std::string& prefix, std::uint64_t interval = 1 << 20)
+        : m_interval(interval) {
+        m_data = open(Capture::data_path(prefix));
+        m_index = open(Capture::index_path(prefix));
+        Capture::IndexHeader header{};
+        std::memcpy(header.magic, Capture::MAGIC, sizeof(header.magic));
+        header.version = Capture::VERSION;
+        header.entry_size = sizeof(Capture::IndexEntry);
+        header.interval = interval;
+        write(m_index, &header, sizeof(header));
+    }
+
+    CaptureWriter(const CaptureWriter&) = delete;
+    CaptureWriter& operator=(const CaptureWriter&) = delete;
+
+    ~CaptureWriter() { close(); }
+
+    // `chunk` arrived at `time`; frames starting in it are indexed with it
+    void write(std::string_view chunk, std::uint64_t time) {
+        auto* data = reinterpret_cast<const std::uint8_t*>(chunk.data());
+        write(m_data, data, chunk.size());
+        scan(data, chunk.size(), time);
+        m_offset += chunk.size();
+    }
+
+    void flush() {
+        std::fflush(m_data);
+        std::fflush(m_index);
+    }
+
+    void close() {
+        if (m_data)
+            std::fclose(m_data);
+        if (m_index)
+            std::fclose(m_index);
+        m_data = nullptr;
+        m_index = nullptr;
+    }
+
+    std::uint64_t bytes() const { return m_offset; }
+
+    std::uint64_t frames() const { return m_frames; }
+};
+
+class CaptureReader {
+  public:
+    // [begin, end) byte range of the stream, starting at a frame header
+    struct Range {
+        std::uint64_t begin;
+        std::uint64_t end;
+        std::uint64_t begin_time;
+        std::uint64_t frame_number;
+    };
+
+  private:
+    MappedFile m_data;
+    MappedFile m_index;
+    const Capture::IndexEntry* m_entries = nullptr;
+    std::size_t m_count = 0;
+
+    // first entry with timestamp > time
+    std::size_t upper_bound(std::uint64_t time) const {
+        return std::upper_bound(m_entries, m_entries + m_count, time,
+                                [](std::uint64_t t,
+                                   const Capture::IndexEntry& entry) {
+                                    return t < entry.timestamp;
+                                }) -
+               m_entries;
+    }
+
+    // first entry with timestamp >= time
+    std::size_t lower_bound(std::uint64_t time) const {
+        return std::lower_bound(m_entries, m_entries + m_count, time,
+                                [](const Capture::IndexEntry& entry,
+                                   std::uint64_t t) {
+                                    return entry.timestamp < t;
+                                }) -
+               m_entries;
+    }
+
+    // last entry with timestamp < time, or the first entry: unindexed
+    // frames stamped `time` may precede the first entry stamped `time`
+    std::size_t entry_at(std::uint64_t time) const {
+        std::size_t idx = lower_bound(time);
+        return idx == 0 ? 0 : idx - 1;
+    }
+
+  public:
+    CaptureReader(const std::string& prefix)
+        : m_data(MappedFile::open(Capture::data_path(prefix))),
+          m_index(MappedFile::open(Capture::index_path(prefix))) {
+        Capture::IndexHeader header{};
+        if (m_index.size() >= sizeof(header))
+            std::memcpy(&header, m_index.data(), sizeof(header));
+        if ((std::memcmp(header.magic, Capture::MAGIC, 8) != 0) ||
+            (header.entry_size != sizeof(Capture::IndexEntry))) {
+            throw std::runtime_error("Not a capture index: " +
+                                     Capture::index_path(prefix));
+        }
+        m_entries = reinterpret_cast<const Capture::IndexEntry*>(
+            m_index.data() + sizeof(header));
+        m_count = (m_index.size() - sizeof(header)) /
+                  sizeof(Capture::IndexEntry);
+        // entries past the end of a truncated data file are unusable
+        while ((m_count > 0) && (m_entries[m_count - 1].offset >= size()))
+            m_count--;
+    }
+
+    std::uint64_t size() const { return m_data.size(); }
+
+    std::string_view data() const {
+        return std::string_view(reinterpret_cast<const char*>(m_data.data()),
+                                m_data.size());
+    }
+
+    std::string_view data(const Range& range) const {
+        return data().substr(range.begin, range.end - range.begin);
+    }
+
+    std::size_t index_size() const { return m_count; }
+
+    const Capture::IndexEntry& index_entry(std::size_t i) const {
+        return m_entries[i];
+    }
+
+    // Range from the last indexed frame before `begin_time` to the
+    // first indexed frame after `end_time` (or the end of the capture).
+    // Starting a FrameParser at range.begin and stopping once frames are
+    // past end_time visits every frame in [begin_time, end_time].
+    Range seek(std::uint64_t begin_time, std::uint64_t end_time = ~0ULL) const {
+        if (m_count == 0)
+            return {0, size(), 0, 0};
+        const auto& first = m_entries[entry_at(begin_time)];
+        std::size_t last = upper_bound(end_time);
+        std::uint64_t end = last < m_count ? m_entries[last].offset : size();
+        return {first.offset, end, first.timestamp, first.frame_number};
+    }
+
+    // Split the frames of [begin_time, end_time] into up to `parts` ranges
+    // of roughly equal size, each starting on an indexed frame boundary
+    std::vector<Range> partition(std::size_t parts,
+                                 std::uint64_t begin_time = 0,
+                                 std::uint64_t end_time = ~0ULL) const {
+        std::vector<Range> out;
+        if (m_count == 0) {
+            out.push_back({0, size(), 0, 0});
+            return out;
+        }
+        std::size_t first = entry_at(begin_time);
+        std::size_t last = upper_bound(end_time);
+        std::uint64_t end = last < m_count ? m_entries[last].offset : size();
+        std::uint64_t begin = m_entries[first].offset;
+        parts = std::max<std::size_t>(parts, 1);
+        std::size_t entry = first;
+        for (std::size_t i = 0; i < parts && entry < last; i++) {
+            // first indexed frame at or past the ideal split point
+            std::uint64_t target = begin + (end - begin) * (i + 1) / parts;
+            std::size_t next = entry + 1;
+            while ((next < last) && (m_entries[next].offset < target))
+                next++;
+            std::uint64_t stop = next < last ? m_entries[next].offset : end;
+            out.push_back({m_entries[entry].offset, stop,
+                           m_entries[entry].timestamp,
+                           m_entries[entry].frame_number});
+            entry = next;
+        }
+        return out;
+    }
+
+    // Parse `range` with `parser`, calling on_frame(const Frame&) for every
+    // frame. Bytes are fed one index interval at a time and tagged with that
+    // entry's timestamp, so frames carry index-granularity receive times.
+    template <typename Parser, typename F>
+    std::uint64_t replay(const Range& range, Parser& parser,
+                         F&& on_frame) const {
+        parser.clear();
+        std::uint64_t frames = 0;
+        std::size_t entry = entry_at(range.begin_time);
+        while ((entry < m_count) && (m_entries[entry].offset < range.begin))
+            entry++;
+        std::uint64_t offset = range.begin;
+        std::uint64_t time = range.begin_time;
+        while (offset < range.end) {
+            std::uint64_t stop = range.end;
+            if ((entry + 1 < m_count) &&
+                (m_entries[entry + 1].offset < range.end))
+                stop = m_entries[entry + 1].offset;
+            if ((entry < m_count) && (m_entries[entry].offset == offset))
+                time = m_entries[entry].timestamp;
+            auto frame = parser.update(
+                data().substr(offset, stop - offset), time);
+            while (frame.has_value()) {
+                frames++;
+                on_frame(*frame);
+                frame = parser.update(false);
+            }
+            offset = stop;
+            entry++;
+        }
+        return frames;
+    }
+};
+
+} // namespace wsframe
+
+#endif // _WSFRAME_CAPTURE_HPP_
@@ -0,0 +1,303 @@
+#ifndef _WSFRAME_CHAIN_PARSER_HPP_
+#define _WSFRAME_CHAIN_PARSER_HPP_
+
+// Frame parsing over non-contiguous input: a chain of buffers (slabs,
+// iovecs) handed over in one call, without first copying it together.
+//
+// Frames that are complete within the chain are passed to a callback with
+// their payload pointing into the slabs: one view when the payload sits in
+// a single slab, otherwise one view per slab it touches (FRAGMENTS) or a
+// copy into a scratch buffer (COALESCE). Headers may straddle slabs. Only a
+// frame left incomplete at the end of a chain is copied, into a carry
+// buffer that the next chain completes.
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <vector>
+
+#include <sys/uio.h>
+
+#include "wsframe.hpp"
+
+namespace wsframe {
+
+class ChainParser {
+  public:
+    enum class PayloadMode {
+        // one view per slab the payload touches
+        FRAGMENTS,
+        // payloads crossing a slab boundary are copied into one buffer
+        COALESCE
+    };
+
+    struct ChainFrame {
+        // header fields; frame.payload is the whole payload if contiguous(),
+        // empty otherwise
+        Frame frame;
+        FrameHeader header;
+        // payload pieces in order (as on the wire, i.e. still masked)
+        std::vector<std::string_view> fragments;
+
+        bool contiguous() const { return fragments.size() <= 1; }
+
+        // copy the payload to `out`, which must hold header.payload_len
+        // bytes; with `unmask`, masked payloads are unmasked on the way
+        void copy_payload(std::uint8_t* out, bool unmask = false) const {
+            std::size_t done = 0;
+            for (auto fragment : fragments) {
+                auto* data =
+                    reinterpret_cast<const std::uint8_t*>(fragment.data());
+                if (unmask && header.mask) {
+                    apply_mask(out + done, data, fragment.size(),
+                               header.masking_key, done % 4);
+                } else {
+                    std::memcpy(out + done, data, fragment.size());
+                }
+                done += fragment.size();
+            }
+        }
+    };
+
+  private:
+    // read position in a chain
+    class Cursor {
+      private:
+        const std::string_view* m_pieces;
+        std::size_t m_count;
+        std::size_t m_idx = 0;
+        std::size_t m_off = 0;
+        std::uint64_t m_left = 0;
+
+        // step over exhausted (and empty) pieces
+        void normalize() {
+            while ((m_idx < m_count) && (m_off == m_pieces[m_idx].size())) {
+                m_idx++;
+                m_off = 0;
+            }
+        }
+
+      public:
+        Cursor(const std::string_view* pieces, std::size_t count)
+            : m_pieces(pieces), m_count(count) {
+            for (std::size_t i = 0; i < count; i++) {
+                m_left += pieces[i].size();
+            }
+            normalize();
+        }
+
+        std::uint64_t left() const { return m_left; }
+
+        const std::uint8_t* ptr() const {
+            return reinterpret_cast<const std::uint8_t*>(
+                m_pieces[m_idx].data() + m_off);
+        }
+
+        // bytes left in the current piece
+        std::size_t contiguous() const {
+            return m_idx == m_count ? 0 : m_pieces[m_idx].size() - m_off;
+        }
+
+        void advance(std::size_t n) {
+            m_left -= n;
+            while (n > 0) {
+                std::size_t step = std::min(n, contiguous());
+                m_off += step;
+                n -= step;
+                normalize();
+            }
+        }
+
+        // copy up to `n` bytes without consuming them, returns the count
+        std::size_t peek(std::uint8_t* out, std::size_t n) const {
+            std::size_t done = 0;
+            std::size_t idx = m_idx;
+            std::size_t off = m_off;
+            while ((done < n) && (idx < m_count)) {
+                std::size_t step =
+                    std::min(n - done, m_pieces[idx].size() - off);
+                std::memcpy(out + done, m_pieces[idx].data() + off, step);
+                done += step;
+                idx++;
+                off = 0;
+            }
+            return done;
+        }
+
+        void read(std::uint8_t* out, std::size_t n) {
+            while (n > 0) {
+                std::size_t step = std::min(n, contiguous());
+                std::memcpy(out, ptr(), step);
+                out += step;
+                n -= step;
+                advance(step);
+            }
+        }
+    };
+
+    PayloadMode m_mode;
+    // incomplete frame at the end of the previous chain
+    FrameBuffer m_carry;
+    FrameBuffer m_scratch;
+    ChainFrame m_out;
+    std::vector<std::string_view> m_iov;
+
+    void pull(Cursor& cursor, std::size_t n) {
+        if (n == 0)
+            return;
+        m_carry.ensure_extra_space(n);
+        cursor.read(m_carry.tail(), n);
+        m_carry.claim_space(n);
+    }
+
+    // copy from the chain into the carry buffer until it holds a whole frame
+    bool complete_carry(Cursor& cursor) {
+        FrameHeader header;
+        std::size_t header_len;
+        while ((header_len = FrameHeader::decode(m_carry.head(), m_carry.size(),
+                                                 header)) == 0) {
+            std::size_t want =
+                m_carry.size() < 2
+                    ? 2 - m_carry.size()
+                    : Frame::header_size(m_carry.head()[1]) - m_carry.size();
+            if (cursor.left() == 0)
+                return false;
+            pull(cursor, static_cast<std::size_t>(
+                             std::min<std::uint64_t>(want, cursor.left())));
+        }
+        std::uint64_t missing = header_len + header.payload_len - m_carry.size();
+        pull(cursor, static_cast<std::size_t>(
+                         std::min<std::uint64_t>(missing, cursor.left())));
+        return m_carry.size() == header_len + header.payload_len;
+    }
+
+    void set_frame(const FrameHeader& header) {
+        m_out.header = header;
+        m_out.frame = {};
+        m_out.frame.fin = header.fin;
+        m_out.frame.mask = header.mask;
+        m_out.frame.opcode = header.opcode;
+        m_out.frame.rsv = header.rsv;
+        m_out.frame.masking_key = header.masking_key;
+        m_out.fragments.clear();
+    }
+
+    void set_payload(std::string_view payload) {
+        m_out.frame.payload = payload;
+        m_out.fragments.push_back(payload);
+    }
+
+    template <typename F> void deliver_carry(F& on_frame) {
+        FrameHeader header;
+        std::size_t header_len =
+            FrameHeader::decode(m_carry.head(), m_carry.size(), header);
+        set_frame(header);
+        if (header.payload_len > 0) {
+            set_payload(std::string_view(
+                reinterpret_cast<const char*>(m_carry.head() + header_len),
+                header.payload_len));
+        }
+        on_frame(static_cast<const ChainFrame&>(m_out));
+        m_carry.reset();
+    }
+
+    void read_payload(Cursor& cursor, std::size_t len) {
+        if (len == 0)
+            return;
+        if (cursor.contiguous() >= len) {
+            set_payload(std::string_view(
+                reinterpret_cast<const char*>(cursor.ptr()), len));
+            cursor.advance(len);
+            return;
+        }
+        if (m_mode == PayloadMode::COALESCE) {
+            m_scratch.reset();
+            m_scratch.ensure_fit(len);
+            std::uint8_t* out = m_scratch.get_space(len);
+            cursor.read(out, len);
+            set_payload(std::string_view(reinterpret_cast<const char*>(out),
+                                         len));
+            return;
+        }
+        while (len > 0) {
+            std::size_t step = std::min(len, cursor.contiguous());
+            m_out.fragments.emplace_back(
+                reinterpret_cast<const char*>(cursor.ptr()), step);
+            cursor.advance(step);
+            len -= step;
+        }
+    }
+
+  public:
+    ChainParser(PayloadMode mode = PayloadMode::FRAGMENTS,
+                std::size_t initial_capacity = 4096)
+        : m_mode(mode), m_carry(initial_capacity), m_scratch(initial_capacity) {}
+
+    // Parse the chain `pieces[0..count)`, calling on_frame(const ChainFrame&)
+    // for every frame completed by it, in order. Views are valid until the
+    // callback returns (and, for those pointing into the chain, as long as
+    // the chain itself). Returns the number of frames.
+    template <typename F>
+    std::size_t update(const std::string_view* pieces, std::size_t count,
+                       F&& on_frame) {
+        Cursor cursor(pieces, count);
+        std::size_t frames = 0;
+        if (m_carry.size() > 0) {
+            if (!complete_carry(cursor))
+                return 0;
+            deliver_carry(on_frame);
+            frames++;
+        }
+        while (cursor.left() > 0) {
+            FrameHeader header;
+            std::size_t header_len;
+            if (cursor.contiguous() >= Frame::MAX_HEADER_SIZE) {
+                header_len = FrameHeader::decode(
+                    cursor.ptr(), cursor.contiguous(), header);
+            } else {
+                // header may straddle pieces
+                std::uint8_t bytes[Frame::MAX_HEADER_SIZE];
+                std::size_t have = cursor.peek(bytes, sizeof(bytes));
+                header_len = FrameHeader::decode(bytes, have, header);
+            }
+            if ((header_len == 0) ||
+                (cursor.left() - header_len < header.payload_len)) {
+                pull(cursor, static_cast<std::size_t>(cursor.left()));
+                break;
+            }
+            cursor.advance(header_len);
+            set_frame(header);
+            read_payload(cursor, static_cast<std::size_t>(header.payload_len));
+            on_frame(static_cast<const ChainFrame&>(m_out));
+            frames++;
+        }
+        return frames;
+    }
+
+    template <typename F>
+    std::size_t update(const std::vector<std::string_view>& pieces,
+                       F&& on_frame) {
+        return update(pieces.data(), pieces.size(), on_frame);
+    }
+
+    template <typename F>
+    std::size_t update(const struct iovec* iov, std::size_t count,
+                       F&& on_frame) {
+        m_iov.clear();
+        for (std::size_t i = 0; i < count; i++) {
+            m_iov.emplace_back(static_cast<const char*>(iov[i].iov_base),
+                               iov[i].iov_len);
+        }
+        return update(m_iov.data(), m_iov.size(), on_frame);
+    }
+
+    // bytes of an incomplete frame held over from the previous chain
+    std::size_t carried() const { return m_carry.size(); }
+
+    void clear() { m_carry.reset(); }
+};
+
+} // namespace wsframe
+
+#endif // _WSFRAME_CHAIN_PARSER_HPP_
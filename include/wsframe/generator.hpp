@@ -0,0 +1,362 @@
+#ifndef _WSFRAME_GENERATOR_HPP_
+#define _WSFRAME_GENERATOR_HPP_
+
+// Synthetic WebSocket traffic for benchmarks and tests.
+//
+// A Generator produces a valid frame stream with FrameFactory: text and
+// binary messages with Zipf distributed payload sizes, some of them
+// fragmented, control frames interleaved (also between fragments), masked
+// and unmasked. Payloads are slices of a random pool, so generation costs
+// about one FrameFactory::construct per frame. Output is deterministic for
+// a given config and shard number.
+//
+// Alongside the bytes, each frame can be described by an ExpectedFrame so a
+// parser run can be checked field by field without decoding the stream a
+// second time.
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "mapped_file.hpp"
+#include "wsframe.hpp"
+
+namespace wsframe {
+
+struct GeneratorConfig {
+    std::uint64_t seed = 1;
+    // data message payload sizes: Zipf over [min_payload, max_payload] with
+    // exponent zipf_s, so small sizes are the most frequent
+    std::size_t min_payload = 0;
+    std::size_t max_payload = 64 * 1024;
+    double zipf_s = 1.1;
+    // fraction of data messages that are TEXT (the rest are BINARY)
+    double text_ratio = 0.5;
+    // fraction of data messages split into 2..max_fragments frames
+    double fragment_ratio = 0.1;
+    std::size_t max_fragments = 4;
+    // chance of a PING or PONG before any data frame
+    double control_ratio = 0.05;
+    // fraction of frames that are masked
+    double mask_ratio = 0.0;
+};
+
+// Description of one generated frame; fixed size so lists can be written
+// to and mapped from disk as is
+struct ExpectedFrame {
+    // position of the frame header in the generated stream
+    std::uint64_t offset;
+    std::uint64_t payload_size;
+    // first header byte: fin, rsv and opcode
+    std::uint8_t first_byte;
+    std::uint8_t header_size;
+    std::uint8_t mask;
+    std::uint8_t reserved;
+    std::array<std::uint8_t, 4> masking_key;
+
+    bool fin() const { return first_byte & 0x80; }
+
+    Frame::Opcode opcode() const {
+        return static_cast<Frame::Opcode>(first_byte & 0x0F);
+    }
+
+    std::uint64_t wire_size() const { return header_size + payload_size; }
+
+    // header fields and payload size agree with a parsed frame
+    bool matches(const Frame& frame) const {
+        return (frame.fin == fin()) && (frame.opcode == opcode()) &&
+               (frame.rsv == (first_byte & 0x70)) &&
+               (frame.mask == (mask != 0)) &&
+               (frame.payload.size() == payload_size) &&
+               (!mask || (frame.masking_key == masking_key));
+    }
+};
+static_assert(sizeof(ExpectedFrame) == 24, "");
+
+class Generator {
+  private:
+    GeneratorConfig m_config;
+    XorShift128Plus m_random;
+    FrameFactory m_factory;
+    std::string m_binary_pool;
+    std::string m_text_pool;
+
+    // fragmented message in progress
+    Frame::Opcode m_message_opcode = Frame::Opcode::BINARY;
+    std::size_t m_fragments_left = 0;
+    std::size_t m_fragment_size = 0;
+
+    std::uint64_t m_offset = 0;
+    std::uint64_t m_frames = 0;
+
+    static std::uint64_t splitmix64(std::uint64_t x) {
+        x += 0x9E3779B97F4A7C15ULL;
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+        return x ^ (x >> 31);
+    }
+
+    // uniform in [0, 1)
+    double uniform() { return (m_random.next64() >> 11) * 0x1.0p-53; }
+
+    // bounded continuous power law over ranks [1, n + 1), floored
+    std::size_t zipf_size() {
+        std::size_t lo = m_config.min_payload;
+        std::size_t hi = std::max(m_config.max_payload, lo);
+        double n = static_cast<double>(hi - lo + 1);
+        double u = uniform();
+        double x;
+        if (std::abs(m_config.zipf_s - 1.0) < 1e-9) {
+            x = std::exp(u * std::log(n + 1));
+        } else {
+            double a = 1.0 - m_config.zipf_s;
+            x = std::pow(u * (std::pow(n + 1, a) - 1) + 1, 1 / a);
+        }
+        auto rank = static_cast<std::size_t>(x);
+        return lo + std::min<std::size_t>(rank, hi - lo + 1) - 1;
+    }
+
+    std::string_view payload(std::size_t size, bool text) {
+        const std::string& pool = text ? m_text_pool : m_binary_pool;
+        std::size_t start = m_random.next64() % (pool.size() - size + 1);
+        return std::string_view(pool).substr(start, size);
+    }
+
+    // One frame's worth of random draws
+    struct Draw {
+        bool fin;
+        Frame::Opcode opcode;
+        bool mask;
+        std::string_view data;
+
+        std::size_t wire_size() const {
+            std::size_t n = data.size();
+            return 2 + (n < 126 ? 0 : n <= 0xFFFF ? 2 : 8) + (mask ? 4 : 0) +
+                   n;
+        }
+    };
+
+    Draw draw() {
+        bool fin = true;
+        Frame::Opcode opcode;
+        std::string_view data;
+        if ((m_config.control_ratio > 0) &&
+            (uniform() < m_config.control_ratio)) {
+            opcode = (m_random.next64() & 1) ? Frame::Opcode::PING
+                                             : Frame::Opcode::PONG;
+            data = payload(m_random.next64() % 126, false);
+        } else if (m_fragments_left > 0) {
+            opcode = Frame::Opcode::CONTINUATION;
+            fin = --m_fragments_left == 0;
+            data = payload(m_fragment_size,
+                           m_message_opcode == Frame::Opcode::TEXT);
+        } else {
+            bool text = uniform() < m_config.text_ratio;
+            opcode = text ? Frame::Opcode::TEXT : Frame::Opcode::BINARY;
+            std::size_t size = zipf_size();
+            if ((m_config.max_fragments >= 2) &&
+                (uniform() < m_config.fragment_ratio)) {
+                std::size_t fragments =
+                    2 + m_random.next64() % (m_config.max_fragments - 1);
+                m_message_opcode = opcode;
+                m_fragments_left = fragments - 1;
+                m_fragment_size = size / fragments;
+                size = m_fragment_size;
+                fin = false;
+            }
+            data = payload(size, text);
+        }
+        bool mask = (m_config.mask_ratio > 0) &&
+                    (uniform() < m_config.mask_ratio);
+        return {fin, opcode, mask, data};
+    }
+
+  public:
+    // Shard `shard` of the stream described by `config`: shards use
+    // independent seeds derived from config.seed
+    Generator(const GeneratorConfig& config, std::uint64_t shard = 0)
+        : m_config(config),
+          m_random(splitmix64(config.seed ^ splitmix64(shard)),
+                   splitmix64(~config.seed ^ splitmix64(shard + 1))) {
+        m_factory.seed_random(m_random.next64(), m_random.next64());
+        std::size_t pool_size =
+            std::max<std::size_t>(m_config.max_payload, 1 << 20);
+        m_binary_pool.resize(pool_size);
+        m_random.fill_bytes(
+            reinterpret_cast<std::uint8_t*>(m_binary_pool.data()), pool_size);
+        m_text_pool.resize(pool_size);
+        for (std::size_t i = 0; i < pool_size; i++) {
+            m_text_pool[i] = static_cast<char>(
+                'a' + static_cast<std::uint8_t>(m_binary_pool[i]) % 26);
+        }
+    }
+
+    // Next frame; the view is valid until the next call
+    std::string_view next(ExpectedFrame* expected = nullptr) {
+        Draw frame = draw();
+        std::string_view raw =
+            m_factory.construct(frame.fin, frame.opcode, frame.mask, frame.data);
+        if (expected) {
+            auto* bytes = reinterpret_cast<const std::uint8_t*>(raw.data());
+            expected->offset = m_offset;
+            expected->payload_size = frame.data.size();
+            expected->first_byte = bytes[0];
+            expected->header_size =
+                static_cast<std::uint8_t>(raw.size() - frame.data.size());
+            expected->mask = frame.mask;
+            expected->reserved = 0;
+            expected->masking_key = {};
+            if (frame.mask) {
+                std::memcpy(expected->masking_key.data(),
+                            bytes + expected->header_size - 4, 4);
+            }
+        }
+        m_offset += raw.size();
+        m_frames++;
+        return raw;
+    }
+
+    // Append frames to `out` until at least `bytes` were appended and no
+    // fragmented message is left open. Expected offsets count from the start
+    // of this generator's stream, not of `out`.
+    void generate(std::string& out, std::size_t bytes,
+                  std::vector<ExpectedFrame>* expected = nullptr) {
+        std::size_t target = out.size() + bytes;
+        out.reserve(target + m_config.max_payload + Frame::MAX_HEADER_SIZE);
+        ExpectedFrame frame;
+        while ((out.size() < target) || in_message()) {
+            out.append(next(expected ? &frame : nullptr));
+            if (expected)
+                expected->push_back(frame);
+        }
+    }
+
+    // Count the bytes and frames generate(out, bytes) would produce, making
+    // the same random draws without encoding anything; bytes() and frames()
+    // hold the result. Masking keys come from the factory's own generator,
+    // which this skips, so encode with a fresh Generator of the same shard.
+    void plan(std::size_t bytes) {
+        std::uint64_t target = m_offset + bytes;
+        while ((m_offset < target) || in_message()) {
+            m_offset += draw().wire_size();
+            m_frames++;
+        }
+    }
+
+    // Write the frames of generate(out, bytes) straight to `out`, whose
+    // `size` plan(bytes) gave for the same shard, and their descriptions to
+    // `expected`, which has room for as many frames as plan(bytes) counted
+    void generate(std::uint8_t* out, std::size_t size,
+                  ExpectedFrame* expected = nullptr) {
+        std::size_t written = 0;
+        while (written < size) {
+            std::string_view raw = next(expected);
+            std::memcpy(out + written, raw.data(), raw.size());
+            written += raw.size();
+            if (expected)
+                expected++;
+        }
+    }
+
+    bool in_message() const { return m_fragments_left > 0; }
+
+    std::uint64_t bytes() const { return m_offset; }
+
+    std::uint64_t frames() const { return m_frames; }
+};
+
+namespace detail {
+
+template <typename F> void for_each_shard(std::size_t threads, F&& fn) {
+    std::vector<std::thread> workers;
+    for (std::size_t i = 0; i < threads; i++) {
+        workers.emplace_back([&fn, i] { fn(i); });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+// Generate about `bytes` of traffic as `threads` shards in parallel, shard i
+// from Generator(config, i), back to back into `alloc(total size)`: a first
+// pass sizes every shard from its random draws alone, so the bytes are
+// written once, in place. Returns the total size.
+template <typename Alloc>
+std::size_t generate_into(const GeneratorConfig& config, std::size_t bytes,
+                          std::size_t threads, Alloc&& alloc,
+                          std::vector<ExpectedFrame>* expected) {
+    threads = std::max<std::size_t>(threads, 1);
+    std::vector<std::uint64_t> offsets(threads + 1, 0);
+    std::vector<std::uint64_t> frame_offsets(threads + 1, 0);
+    auto share = [&](std::size_t i) {
+        return bytes / threads + (i < bytes % threads);
+    };
+    for_each_shard(threads, [&](std::size_t i) {
+        Generator generator(config, i);
+        generator.plan(share(i));
+        offsets[i + 1] = generator.bytes();
+        frame_offsets[i + 1] = generator.frames();
+    });
+    for (std::size_t i = 0; i < threads; i++) {
+        offsets[i + 1] += offsets[i];
+        frame_offsets[i + 1] += frame_offsets[i];
+    }
+    std::uint8_t* out = alloc(static_cast<std::size_t>(offsets.back()));
+    if (expected)
+        expected->resize(frame_offsets.back());
+    for_each_shard(threads, [&](std::size_t i) {
+        Generator generator(config, i);
+        ExpectedFrame* frames =
+            expected ? expected->data() + frame_offsets[i] : nullptr;
+        generator.generate(out + offsets[i], offsets[i + 1] - offsets[i],
+                           frames);
+        if (!frames)
+            return;
+        // rebase offsets from the shard's stream to the whole one
+        for (std::uint64_t n = frame_offsets[i]; n < frame_offsets[i + 1];
+             n++) {
+            (*expected)[n].offset += offsets[i];
+        }
+    });
+    return static_cast<std::size_t>(offsets.back());
+}
+
+} // namespace detail
+
+// One stream of about `bytes` generated on `threads` threads into memory
+inline void generate(const GeneratorConfig& config, std::size_t bytes,
+                     std::size_t threads, std::string& out,
+                     std::vector<ExpectedFrame>* expected = nullptr) {
+    detail::generate_into(
+        config, bytes, threads,
+        [&](std::size_t size) {
+            out.resize(size);
+            return reinterpret_cast<std::uint8_t*>(out.data());
+        },
+        expected);
+}
+
+// As above, into a newly created memory-mapped file; returns its size
+inline std::size_t generate_file(const GeneratorConfig& config,
+                                 std::size_t bytes, std::size_t threads,
+                                 const std::string& path,
+                                 std::vector<ExpectedFrame>* expected = nullptr) {
+    MappedFile file;
+    return detail::generate_into(
+        config, bytes, threads,
+        [&](std::size_t size) {
+            file = MappedFile::create(path, size, false);
+            return file.data();
+        },
+        expected);
+}
+
+} // namespace wsframe
+
+#endif // _WSFRAME_GENERATOR_HPP_
@@ -0,0 +1,316 @@
+#ifndef _WSFRAME_JOURNAL_HPP_
+#define _WSFRAME_JOURNAL_HPP_
+
+// Append-only frame journal on memory-mapped segment files.
+//
+// A journal is a sequence of segments `<prefix>.000000.wsj`,
+// `<prefix>.000001.wsj`, ... Each segment is created at its full size and
+// mapped once, so appending a record is a memcpy into the mapping: no
+// syscalls until the segment is full. Layout (host byte order):
+//
+//   segment: SegmentHeader (64 bytes), records..., zero fill
+//   record:  RecordHeader (48 bytes), payload, padding to 8 bytes
+//
+// A record becomes visible when its `record_size` is stored (with release
+// semantics) after the rest of it has been written, so a reader mapping a
+// live segment stops cleanly at the first zero `record_size`. Likewise a
+// segment header is published by storing the first magic byte last.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include "mapped_file.hpp"
+#include "wsframe.hpp"
+
+namespace wsframe {
+
+class Journal {
+  public:
+    enum class Direction : std::uint8_t { INBOUND = 0, OUTBOUND = 1 };
+
+    struct SegmentHeader {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t header_size;
+        std::uint64_t index;
+        std::uint64_t capacity;
+        std::uint8_t reserved[32];
+    };
+    static_assert(sizeof(SegmentHeader) == 64, "");
+
+    struct RecordHeader {
+        // total bytes including this header and padding, 0 = end of segment
+        std::uint32_t record_size;
+        std::uint8_t direction;
+        std::uint8_t header_size;
+        std::uint16_t reserved;
+        std::uint64_t payload_size;
+        std::uint64_t timestamp;
+        std::uint64_t connection_id;
+        // the frame header exactly as on the wire
+        std::uint8_t header[16];
+    };
+    static_assert(sizeof(RecordHeader) == 48, "");
+
+    static constexpr char MAGIC[8] = {'W', 'S', 'J', 'R', 'N', 'L', 0, 1};
+    static constexpr std::uint32_t VERSION = 1;
+
+    static std::string segment_path(const std::string& prefix,
+                                    std::uint64_t index) {
+        char name[32];
+        std::snprintf(name, sizeof(name), ".%06llu.wsj",
+                      static_cast<unsigned long long>(index));
+        return prefix + name;
+    }
+
+    static constexpr std::size_t record_size(std::size_t payload_size) {
+        return (sizeof(RecordHeader) + payload_size + 7) & ~std::size_t(7);
+    }
+};
+
+// Single writer. Records point at nothing outside the mapping, so a writer
+// can be handed Frames straight from a FrameParser or the raw output of a
+// FrameFactory.
+class JournalWriter {
+  private:
+    std::string m_prefix;
+    std::size_t m_segment_size;
+    bool m_preallocate;
+    std::uint64_t m_index = 0;
+    MappedFile m_segment;
+    std::size_t m_offset = 0;
+
+    void open_segment(std::size_t min_size) {
+        std::size_t size = std::max(
+            m_segment_size, sizeof(Journal::SegmentHeader) + min_size +
+                                sizeof(Journal::RecordHeader));
+        m_segment = MappedFile::create(
+            Journal::segment_path(m_prefix, m_index), size, m_preallocate);
+        Journal::SegmentHeader header{};
+        std::memcpy(header.magic, Journal::MAGIC, sizeof(header.magic));
+        header.version = Journal::VERSION;
+        header.header_size = sizeof(Journal::SegmentHeader);
+        header.index = m_index;
+        header.capacity = size;
+        // publish with the first magic byte, which readers wait for
+        header.magic[0] = 0;
+        std::memcpy(m_segment.data(), &header, sizeof(header));
+        __atomic_store_n(m_segment.data(),
+                         static_cast<std::uint8_t>(Journal::MAGIC[0]),
+                         __ATOMIC_RELEASE);
+        m_offset = sizeof(header);
+        m_index++;
+    }
+
+    std::uint8_t* reserve(std::size_t size) {
+        // keep room for the zero record_size that terminates the segment
+        if (m_offset + size + sizeof(std::uint32_t) > m_segment.size())
+            open_segment(size);
+        return m_segment.data() + m_offset;
+    }
+
+    void append(Journal::Direction direction, std::uint64_t connection_id,
+                std::uint64_t timestamp, const std::uint8_t* header,
+                std::size_t header_size, const void* payload,
+                std::size_t payload_size) {
+        std::size_t size = Journal::record_size(payload_size);
+        // record_size is 32 bits; a truncated one would hide every later
+        // record from readers
+        if (size > UINT32_MAX)
+            throw std::runtime_error("JournalWriter: record exceeds 4 GB");
+        std::uint8_t* out = reserve(size);
+
+        Journal::RecordHeader record{};
+        record.direction = static_cast<std::uint8_t>(direction);
+        record.header_size = static_cast<std::uint8_t>(header_size);
+        record.payload_size = payload_size;
+        record.timestamp = timestamp;
+        record.connection_id = connection_id;
+        std::memcpy(record.header, header, header_size);
+        std::memcpy(out, &record, sizeof(record));
+        std::memcpy(out + sizeof(record), payload, payload_size);
+
+        // publish
+        __atomic_store_n(reinterpret_cast<std::uint32_t*>(out),
+                         static_cast<std::uint32_t>(size), __ATOMIC_RELEASE);
+        m_offset += size;
+    }
+
+  public:
+    // `segment_size` bytes are mapped per segment; records larger than that
+    // get a segment of their own
+    JournalWriter(std::string prefix, std::size_t segment_size = 64 << 20,
+                  bool preallocate = true)
+        : m_prefix(std::move(prefix)), m_segment_size(segment_size),
+          m_preallocate(preallocate) {
+        open_segment(0);
+    }
+
+    // Payload is stored as is, i.e. still masked for masked frames, so
+    // header + payload are the exact wire bytes. Records are limited to
+    // 4 GB (std::runtime_error beyond).
+    void write(const Frame& frame, Journal::Direction direction,
+               std::uint64_t connection_id, std::uint64_t timestamp) {
+        std::uint8_t header[Frame::MAX_HEADER_SIZE];
+        std::size_t header_size = frame.write_header(header);
+        append(direction, connection_id, timestamp, header, header_size,
+               frame.payload.data(), frame.payload.size());
+    }
+
+    // Inbound frames default to the time their last byte arrived
+    void write(const Frame& frame, Journal::Direction direction,
+               std::uint64_t connection_id) {
+        write(frame, direction, connection_id, frame.last_byte_time);
+    }
+
+    // One complete encoded frame, e.g. the view returned by FrameFactory
+    void write_raw(std::string_view raw, Journal::Direction direction,
+                   std::uint64_t connection_id, std::uint64_t timestamp) {
+        if (raw.size() < 2)
+            throw std::runtime_error("Raw frame shorter than its header");
+        auto* bytes = reinterpret_cast<const std::uint8_t*>(raw.data());
+        std::size_t header_size = Frame::header_size(bytes[1]);
+        if (raw.size() < header_size)
+            throw std::runtime_error("Raw frame shorter than its header");
+        append(direction, connection_id, timestamp, bytes, header_size,
+               bytes + header_size, raw.size() - header_size);
+    }
+
+    // Blocks until everything written so far is on disk
+    void sync() { m_segment.sync(); }
+
+    std::uint64_t segments() const { return m_index; }
+};
+
+// Iterates the records of a journal in order, without copying: entries
+// point into the mapped segments and stay valid while the reader is alive
+// and has not moved past their segment.
+class JournalReader {
+  public:
+    struct Entry {
+        Journal::Direction direction;
+        std::uint64_t timestamp;
+        std::uint64_t connection_id;
+        std::string_view header;
+        std::string_view payload;
+
+        // Decoded header; the payload is as recorded (masked if mask is set)
+        Frame frame() const {
+            auto* bytes = reinterpret_cast<const std::uint8_t*>(header.data());
+            Frame out;
+            out.fin = bytes[0] & 0x80;
+            out.rsv = bytes[0] & 0x70;
+            out.opcode = static_cast<Frame::Opcode>(bytes[0] & 0x0F);
+            out.mask = bytes[1] & 0x80;
+            if (out.mask) {
+                std::memcpy(out.masking_key.data(),
+                            bytes + header.size() - 4, 4);
+            }
+            out.payload = payload;
+            out.first_byte_time = timestamp;
+            out.last_byte_time = timestamp;
+            return out;
+        }
+
+        // header + payload as they were on the wire
+        std::size_t wire_size() const {
+            return header.size() + payload.size();
+        }
+    };
+
+  private:
+    std::string m_prefix;
+    std::uint64_t m_index = 0;
+    MappedFile m_segment;
+    std::size_t m_offset = 0;
+
+    // false if the next segment does not exist (yet)
+    bool open_segment() {
+        std::string path = Journal::segment_path(m_prefix, m_index);
+        if (!MappedFile::exists(path))
+            return false;
+        MappedFile segment = MappedFile::open(path);
+        Journal::SegmentHeader header{};
+        // writer is still creating it
+        if ((segment.size() < sizeof(header)) ||
+            (__atomic_load_n(segment.data(), __ATOMIC_ACQUIRE) == 0))
+            return false;
+        std::memcpy(&header, segment.data(), sizeof(header));
+        if (std::memcmp(header.magic, Journal::MAGIC, 8) != 0) {
+            throw std::runtime_error("Not a journal segment: " + path);
+        }
+        if ((header.version != Journal::VERSION) ||
+            (header.header_size < sizeof(header)) ||
+            (header.header_size % 8 != 0) ||
+            (header.header_size > segment.size())) {
+            throw std::runtime_error("Unsupported journal segment: " + path);
+        }
+        m_segment = std::move(segment);
+        m_segment.advise_sequential();
+        m_offset = header.header_size;
+        m_index++;
+        return true;
+    }
+
+    std::uint32_t load_size() const {
+        if (m_offset + sizeof(Journal::RecordHeader) > m_segment.size())
+            return 0;
+        return __atomic_load_n(reinterpret_cast<const std::uint32_t*>(
+                                   m_segment.data() + m_offset),
+                               __ATOMIC_ACQUIRE);
+    }
+
+  public:
+    JournalReader(std::string prefix) : m_prefix(std::move(prefix)) {
+        if (!open_segment()) {
+            throw std::runtime_error("No journal at " + m_prefix);
+        }
+    }
+
+    // Next record, or nothing at the end of the journal. When reading a
+    // journal that is still being written, call again later to pick up new
+    // records.
+    std::optional<Entry> next() {
+        std::uint32_t size = load_size();
+        while (size == 0) {
+            if (!MappedFile::exists(Journal::segment_path(m_prefix, m_index)))
+                return {};
+            // the writer only moves on once this segment is final, but a
+            // last record may have been published since the load above
+            size = load_size();
+            if (size != 0)
+                break;
+            if (!open_segment())
+                return {};
+            size = load_size();
+        }
+        const std::uint8_t* ptr = m_segment.data() + m_offset;
+        Journal::RecordHeader record;
+        std::memcpy(&record, ptr, sizeof(record));
+        m_offset += size;
+
+        Entry entry;
+        entry.direction = static_cast<Journal::Direction>(record.direction);
+        entry.timestamp = record.timestamp;
+        entry.connection_id = record.connection_id;
+        entry.header = std::string_view(
+            reinterpret_cast<const char*>(ptr) +
+                offsetof(Journal::RecordHeader, header),
+            record.header_size);
+        entry.payload =
+            std::string_view(reinterpret_cast<const char*>(ptr) +
+                                 sizeof(record),
+                             record.payload_size);
+        return entry;
+    }
+};
+
+} // namespace wsframe
+
+#endif // _WSFRAME_JOURNAL_HPP_
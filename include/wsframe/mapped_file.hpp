@@ -0,0 +1,152 @@
+#ifndef _WSFRAME_MAPPED_FILE_HPP_
+#define _WSFRAME_MAPPED_FILE_HPP_
+
+// RAII wrapper around a memory-mapped file (POSIX only), shared by the
+// journal, capture and replay utilities.
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace wsframe {
+
+class MappedFile {
+  private:
+    int m_fd = -1;
+    std::uint8_t* m_data = nullptr;
+    std::size_t m_size = 0;
+
+    static std::runtime_error error(const std::string& what,
+                                    const std::string& path) {
+        return std::runtime_error(what + " " + path + ": " +
+                                  std::strerror(errno));
+    }
+
+    MappedFile(int fd, std::uint8_t* data, std::size_t size)
+        : m_fd(fd), m_data(data), m_size(size) {}
+
+  public:
+    MappedFile() {}
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    MappedFile(MappedFile&& other)
+        : m_fd(std::exchange(other.m_fd, -1)),
+          m_data(std::exchange(other.m_data, nullptr)),
+          m_size(std::exchange(other.m_size, 0)) {}
+
+    MappedFile& operator=(MappedFile&& other) {
+        if (this != &other) {
+            close();
+            m_fd = std::exchange(other.m_fd, -1);
+            m_data = std::exchange(other.m_data, nullptr);
+            m_size = std::exchange(other.m_size, 0);
+        }
+        return *this;
+    }
+
+    ~MappedFile() { close(); }
+
+    // Create (or truncate) `path` with `size` bytes and map it read-write.
+    // With `preallocate`, disk blocks are reserved up front and the pages
+    // are faulted in, so writing through the mapping later never has to
+    // allocate.
+    static MappedFile create(const std::string& path, std::size_t size,
+                             bool preallocate = true) {
+        int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0)
+            throw error("Failed to create", path);
+        if (::ftruncate(fd, static_cast<off_t>(size)) != 0) {
+            ::close(fd);
+            throw error("Failed to size", path);
+        }
+        if (preallocate) {
+            // best effort: not every filesystem supports it
+            (void)::posix_fallocate(fd, 0, static_cast<off_t>(size));
+        }
+        if (size == 0) {
+            return MappedFile(fd, nullptr, 0);
+        }
+        int flags = MAP_SHARED;
+#ifdef MAP_POPULATE
+        if (preallocate)
+            flags |= MAP_POPULATE;
+#endif
+        void* data =
+            ::mmap(nullptr, size, PROT_READ | PROT_WRITE, flags, fd, 0);
+        if (data == MAP_FAILED) {
+            ::close(fd);
+            throw error("Failed to map", path);
+        }
+        return MappedFile(fd, static_cast<std::uint8_t*>(data), size);
+    }
+
+    // Map an existing file read-only
+    static MappedFile open(const std::string& path) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            throw error("Failed to open", path);
+        struct stat st;
+        if (::fstat(fd, &st) != 0) {
+            ::close(fd);
+            throw error("Failed to stat", path);
+        }
+        auto size = static_cast<std::size_t>(st.st_size);
+        if (size == 0) {
+            return MappedFile(fd, nullptr, 0);
+        }
+        void* data = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        if (data == MAP_FAILED) {
+            ::close(fd);
+            throw error("Failed to map", path);
+        }
+        return MappedFile(fd, static_cast<std::uint8_t*>(data), size);
+    }
+
+    static bool exists(const std::string& path) {
+        struct stat st;
+        return ::stat(path.c_str(), &st) == 0;
+    }
+
+    bool is_open() const { return m_fd >= 0; }
+
+    std::uint8_t* data() { return m_data; }
+    const std::uint8_t* data() const { return m_data; }
+
+    std::size_t size() const { return m_size; }
+
+    // hint that the mapping will be read front to back
+    void advise_sequential() {
+        if (m_data)
+            ::madvise(m_data, m_size, MADV_SEQUENTIAL);
+    }
+
+    // flush dirty pages to disk, blocking
+    void sync() {
+        if (m_data)
+            ::msync(m_data, m_size, MS_SYNC);
+    }
+
+    void close() {
+        if (m_data)
+            ::munmap(m_data, m_size);
+        if (m_fd >= 0)
+            ::close(m_fd);
+        m_fd = -1;
+        m_data = nullptr;
+        m_size = 0;
+    }
+};
+
+} // namespace wsframe
+
+#endif // _WSFRAME_MAPPED_FILE_HPP_
@@ -0,0 +1,373 @@
+#ifndef _WSFRAME_PERF_COUNTERS_HPP_
+#define _WSFRAME_PERF_COUNTERS_HPP_
+
+// Hardware performance counter instrumentation for the parser and the
+// encoder. wsframe.hpp only pulls this in (and only instruments its hot
+// paths) when WSFRAME_PERF_COUNTERS is defined; the counter group itself can
+// be used standalone.
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <iomanip>
+#include <ostream>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace wsframe {
+namespace perf {
+
+enum class Event : int {
+    CYCLES,
+    INSTRUCTIONS,
+    BRANCH_MISSES,
+    L1D_MISSES,
+    LLC_MISSES
+};
+
+constexpr std::size_t EVENT_COUNT = 5;
+
+inline const char* event_to_string(Event event) {
+    switch (event) {
+    case Event::CYCLES:
+        return "cycles";
+    case Event::INSTRUCTIONS:
+        return "instructions";
+    case Event::BRANCH_MISSES:
+        return "branch_misses";
+    case Event::L1D_MISSES:
+        return "l1d_misses";
+    case Event::LLC_MISSES:
+        return "llc_misses";
+    }
+    return "unknown";
+}
+
+// Instrumented regions: one per parse stage, one per encoded header size
+enum class Region : int {
+    FIN_BIT,
+    OPCODE,
+    MASK_BIT,
+    PAYLOAD_LEN,
+    EXTENDED_PAYLOAD_LEN_16,
+    EXTENDED_PAYLOAD_LEN_64,
+    MASKING_KEY,
+    PAYLOAD_DATA,
+    ENCODE_LEN_7,
+    ENCODE_LEN_16,
+    ENCODE_LEN_64
+};
+
+constexpr std::size_t REGION_COUNT = 11;
+
+inline const char* region_to_string(Region region) {
+    switch (region) {
+    case Region::FIN_BIT:
+        return "parse.fin_bit";
+    case Region::OPCODE:
+        return "parse.opcode";
+    case Region::MASK_BIT:
+        return "parse.mask_bit";
+    case Region::PAYLOAD_LEN:
+        return "parse.payload_len";
+    case Region::EXTENDED_PAYLOAD_LEN_16:
+        return "parse.extended_payload_len_16";
+    case Region::EXTENDED_PAYLOAD_LEN_64:
+        return "parse.extended_payload_len_64";
+    case Region::MASKING_KEY:
+        return "parse.masking_key";
+    case Region::PAYLOAD_DATA:
+        return "parse.payload_data";
+    case Region::ENCODE_LEN_7:
+        return "encode.len_7";
+    case Region::ENCODE_LEN_16:
+        return "encode.len_16";
+    case Region::ENCODE_LEN_64:
+        return "encode.len_64";
+    }
+    return "unknown";
+}
+
+inline Region encode_region(std::uint64_t payload_length) {
+    if (payload_length < 126U)
+        return Region::ENCODE_LEN_7;
+    if (payload_length <= 0xFFFFU)
+        return Region::ENCODE_LEN_16;
+    return Region::ENCODE_LEN_64;
+}
+
+// A perf_event_open counter group for the calling thread, user space only.
+// Events the kernel (or a VM) does not support are skipped and read as 0.
+// Reads go through rdpmc when the kernel allows it and fall back to a single
+// group read() otherwise.
+class CounterGroup {
+  public:
+    using Values = std::array<std::uint64_t, EVENT_COUNT>;
+
+  private:
+    std::array<int, EVENT_COUNT> m_fds;
+#if defined(__linux__)
+    std::array<perf_event_mmap_page*, EVENT_COUNT> m_pages{};
+#endif
+    // position of each event in a PERF_FORMAT_GROUP read
+    std::array<int, EVENT_COUNT> m_slots;
+    int m_leader = -1;
+    int m_open = 0;
+    bool m_rdpmc = false;
+
+#if defined(__linux__)
+    static bool configure(Event event, perf_event_attr& attr) {
+        switch (event) {
+        case Event::CYCLES:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_CPU_CYCLES;
+            return true;
+        case Event::INSTRUCTIONS:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+            return true;
+        case Event::BRANCH_MISSES:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+            return true;
+        case Event::L1D_MISSES:
+            attr.type = PERF_TYPE_HW_CACHE;
+            attr.config = PERF_COUNT_HW_CACHE_L1D |
+                          (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                          (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+            return true;
+        case Event::LLC_MISSES:
+            attr.type = PERF_TYPE_HW_CACHE;
+            attr.config = PERF_COUNT_HW_CACHE_LL |
+                          (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                          (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+            return true;
+        }
+        return false;
+    }
+
+    // seqlock protected user space read, see perf_event_mmap_page
+    static bool read_rdpmc(const perf_event_mmap_page* page,
+                           std::uint64_t& out) {
+#if defined(__x86_64__) || defined(__i386__)
+        std::uint32_t seq;
+        std::uint64_t count;
+        do {
+            seq = page->lock;
+            __atomic_signal_fence(__ATOMIC_SEQ_CST);
+            std::uint32_t idx = page->index;
+            if (!page->cap_user_rdpmc || (idx == 0))
+                return false;
+            count = page->offset;
+            std::int64_t pmc = __builtin_ia32_rdpmc(idx - 1);
+            int shift = 64 - page->pmc_width;
+            pmc = static_cast<std::int64_t>(static_cast<std::uint64_t>(pmc)
+                                            << shift) >>
+                  shift;
+            count += pmc;
+            __atomic_signal_fence(__ATOMIC_SEQ_CST);
+        } while (page->lock != seq);
+        out = count;
+        return true;
+#else
+        return false;
+#endif
+    }
+#endif
+
+  public:
+    CounterGroup(std::initializer_list<Event> events = {
+                     Event::CYCLES, Event::INSTRUCTIONS, Event::BRANCH_MISSES,
+                     Event::L1D_MISSES, Event::LLC_MISSES}) {
+        m_fds.fill(-1);
+        m_slots.fill(-1);
+#if defined(__linux__)
+        long page_size = sysconf(_SC_PAGESIZE);
+        m_rdpmc = true;
+        for (Event event : events) {
+            perf_event_attr attr;
+            std::memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            if (!configure(event, attr))
+                continue;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_GROUP;
+            int fd = static_cast<int>(
+                syscall(SYS_perf_event_open, &attr, 0, -1, m_leader, 0));
+            if (fd < 0)
+                continue;
+            if (m_leader < 0)
+                m_leader = fd;
+            auto idx = static_cast<std::size_t>(event);
+            m_fds[idx] = fd;
+            m_slots[idx] = m_open++;
+            void* page =
+                mmap(nullptr, page_size, PROT_READ, MAP_SHARED, fd, 0);
+            if (page == MAP_FAILED) {
+                m_rdpmc = false;
+            } else {
+                m_pages[idx] = static_cast<perf_event_mmap_page*>(page);
+            }
+        }
+        m_rdpmc = m_rdpmc && (m_open > 0);
+#endif
+    }
+
+    CounterGroup(const CounterGroup&) = delete;
+    CounterGroup& operator=(const CounterGroup&) = delete;
+
+    ~CounterGroup() {
+#if defined(__linux__)
+        long page_size = sysconf(_SC_PAGESIZE);
+        for (std::size_t i = 0; i < EVENT_COUNT; i++) {
+            if (m_pages[i])
+                munmap(m_pages[i], page_size);
+            if (m_fds[i] >= 0)
+                close(m_fds[i]);
+        }
+#endif
+    }
+
+    bool available() const { return m_open > 0; }
+
+    bool available(Event event) const {
+        return m_fds[static_cast<std::size_t>(event)] >= 0;
+    }
+
+    // Running totals since the group was opened; only differences between
+    // two reads are meaningful
+    void read(Values& out) {
+        out.fill(0);
+#if defined(__linux__)
+        if (m_open == 0)
+            return;
+        if (m_rdpmc) {
+            bool ok = true;
+            for (std::size_t i = 0; (i < EVENT_COUNT) && ok; i++) {
+                if (m_pages[i])
+                    ok = read_rdpmc(m_pages[i], out[i]);
+            }
+            if (ok)
+                return;
+            // not scheduled on a counter or rdpmc disabled, stop trying
+            m_rdpmc = false;
+            out.fill(0);
+        }
+        std::array<std::uint64_t, EVENT_COUNT + 1> buf{};
+        auto len = ::read(m_leader, buf.data(), sizeof(buf));
+        if (len < static_cast<long>(sizeof(std::uint64_t)))
+            return;
+        for (std::size_t i = 0; i < EVENT_COUNT; i++) {
+            if ((m_slots[i] >= 0) &&
+                (static_cast<std::uint64_t>(m_slots[i]) < buf[0]))
+                out[i] = buf[1 + m_slots[i]];
+        }
+#endif
+    }
+};
+
+// Per thread accumulated counter deltas per region
+class Profile {
+  public:
+    struct Totals {
+        std::uint64_t calls = 0;
+        CounterGroup::Values values{};
+    };
+
+  private:
+    CounterGroup m_counters;
+    std::array<Totals, REGION_COUNT> m_totals{};
+
+  public:
+    CounterGroup& counters() { return m_counters; }
+
+    void add(Region region, const CounterGroup::Values& begin,
+             const CounterGroup::Values& end) {
+        auto& totals = m_totals[static_cast<std::size_t>(region)];
+        totals.calls++;
+        for (std::size_t i = 0; i < EVENT_COUNT; i++) {
+            totals.values[i] += end[i] - begin[i];
+        }
+    }
+
+    const Totals& totals(Region region) const {
+        return m_totals[static_cast<std::size_t>(region)];
+    }
+
+    void reset() { m_totals = {}; }
+
+    // One line per region that was entered: calls and per call averages
+    void report(std::ostream& out) const {
+        if (!m_counters.available()) {
+            out << "perf counters unavailable (perf_event_open failed)"
+                << std::endl;
+        }
+        out << std::left << std::setw(32) << "region" << std::right
+            << std::setw(12) << "calls";
+        for (std::size_t i = 0; i < EVENT_COUNT; i++) {
+            out << std::setw(15) << event_to_string(static_cast<Event>(i));
+        }
+        out << std::setw(8) << "ipc" << std::endl;
+        for (std::size_t r = 0; r < REGION_COUNT; r++) {
+            const auto& totals = m_totals[r];
+            if (totals.calls == 0)
+                continue;
+            out << std::left << std::setw(32)
+                << region_to_string(static_cast<Region>(r)) << std::right
+                << std::setw(12) << totals.calls << std::fixed
+                << std::setprecision(2);
+            for (std::size_t i = 0; i < EVENT_COUNT; i++) {
+                out << std::setw(15)
+                    << static_cast<double>(totals.values[i]) / totals.calls;
+            }
+            auto cycles = totals.values[static_cast<int>(Event::CYCLES)];
+            auto instructions =
+                totals.values[static_cast<int>(Event::INSTRUCTIONS)];
+            out << std::setw(8)
+                << (cycles ? static_cast<double>(instructions) / cycles : 0.0)
+                << std::endl;
+        }
+        out.unsetf(std::ios_base::floatfield);
+    }
+};
+
+inline Profile& profile() {
+    static thread_local Profile instance;
+    return instance;
+}
+
+// Attributes the counter deltas between construction and destruction to a
+// region of this thread's profile
+class Scope {
+  private:
+    Profile& m_profile;
+    Region m_region;
+    CounterGroup::Values m_begin;
+
+  public:
+    Scope(Region region) : m_profile(profile()), m_region(region) {
+        m_profile.counters().read(m_begin);
+    }
+
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+    ~Scope() {
+        CounterGroup::Values end;
+        m_profile.counters().read(end);
+        m_profile.add(m_region, m_begin, end);
+    }
+};
+
+} // namespace perf
+} // namespace wsframe
+
+#endif // _WSFRAME_PERF_COUNTERS_HPP_
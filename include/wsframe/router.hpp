@@ -0,0 +1,261 @@
+#ifndef _WSFRAME_ROUTER_HPP_
+#define _WSFRAME_ROUTER_HPP_
+
+// Payload prefix routing, built at compile time.
+//
+// A PrefixRouter maps a payload to the index of the longest registered
+// prefix it starts with, e.g. the {"channel":"..." part of a JSON message,
+// so that frames can be dispatched to a handler table. The prefixes are
+// arranged in a radix tree: the prefix common to all of them is compared
+// once at the root, each node compares the label that no other prefix
+// branches off from with one memcmp, and branching takes one byte compare
+// per sibling. For prefixes that differ early (channel names) a lookup is
+// a couple of short compares regardless of how many are registered.
+//
+// RouteHooks plugs a router into BasicFrameParser, so every TEXT/BINARY
+// frame is routed as it completes, while its payload is still in cache.
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <stdexcept>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "wsframe.hpp"
+
+namespace wsframe {
+
+template <std::size_t N, std::size_t MaxLen> class PrefixRouter {
+    static_assert(N > 0, "no prefixes");
+    static_assert(N < 0x7FFF, "too many prefixes");
+
+  public:
+    static constexpr int NO_ROUTE = -1;
+    // length of the longest prefix; bytes beyond it never affect a route
+    static constexpr std::size_t max_prefix = MaxLen;
+
+  private:
+    struct Node {
+        // the node covers bytes [parent end, end) of prefix `key`
+        std::uint16_t key = 0;
+        std::uint16_t end = 0;
+        std::int16_t route = NO_ROUTE;
+        // children are stored contiguously, ordered by their first byte
+        std::uint16_t first_child = 0;
+        std::uint16_t children = 0;
+    };
+
+    std::array<std::string_view, N> m_prefixes{};
+    // a radix tree over N keys has at most 2N - 1 nodes
+    std::array<Node, 2 * N> m_nodes{};
+    // first label byte of each node, searched when branching
+    std::array<std::uint8_t, 2 * N> m_first{};
+    std::size_t m_node_count = 1;
+
+    static constexpr bool less(std::string_view a, std::string_view b) {
+        return a.compare(b) < 0;
+    }
+
+    // Fill node `at` for the keys order[lo, hi), sorted, which agree on
+    // their first `depth` bytes
+    constexpr void build(const std::array<std::uint16_t, N>& order,
+                         std::size_t lo, std::size_t hi, std::size_t depth,
+                         std::size_t at) {
+        // a key that is a prefix of the others sorts first, and keys in
+        // between agree wherever the first and the last agree
+        std::string_view first = m_prefixes[order[lo]];
+        std::string_view last = m_prefixes[order[hi - 1]];
+        std::size_t end = depth;
+        while ((end < first.size()) && (first[end] == last[end])) {
+            end++;
+        }
+        Node& node = m_nodes[at];
+        node.key = order[lo];
+        node.end = static_cast<std::uint16_t>(end);
+        if (first.size() == end) {
+            node.route = static_cast<std::int16_t>(order[lo]);
+            lo++;
+        }
+        std::size_t groups = 0;
+        for (std::size_t i = lo; i < hi; i++) {
+            if ((i == lo) ||
+                (m_prefixes[order[i]][end] != m_prefixes[order[i - 1]][end]))
+                groups++;
+        }
+        node.first_child = static_cast<std::uint16_t>(m_node_count);
+        node.children = static_cast<std::uint16_t>(groups);
+        std::size_t child = m_node_count;
+        m_node_count += groups;
+        while (lo < hi) {
+            char byte = m_prefixes[order[lo]][end];
+            std::size_t group_end = lo + 1;
+            while ((group_end < hi) &&
+                   (m_prefixes[order[group_end]][end] == byte)) {
+                group_end++;
+            }
+            m_first[child] = static_cast<std::uint8_t>(byte);
+            build(order, lo, group_end, end, child);
+            child++;
+            lo = group_end;
+        }
+    }
+
+    // child of `node` whose label starts with `byte`, or 0
+    constexpr std::size_t child(const Node& node, std::uint8_t byte) const {
+        std::size_t at = node.first_child;
+        std::size_t last = at + node.children;
+        while ((at < last) && (m_first[at] < byte)) {
+            at++;
+        }
+        return ((at < last) && (m_first[at] == byte)) ? at : 0;
+    }
+
+    // descend comparing every label byte; stops at the first mismatch
+    constexpr int walk(std::string_view payload) const {
+        int best = NO_ROUTE;
+        std::size_t at = 0;
+        std::size_t pos = 0;
+        for (;;) {
+            const Node& node = m_nodes[at];
+            if (payload.size() < node.end)
+                return best;
+            const char* label = m_prefixes[node.key].data();
+            for (; pos < node.end; pos++) {
+                if (payload[pos] != label[pos])
+                    return best;
+            }
+            if (node.route != NO_ROUTE)
+                best = node.route;
+            if ((node.children == 0) || (pos == payload.size()))
+                return best;
+            at = child(node, static_cast<std::uint8_t>(payload[pos]));
+            if (at == 0)
+                return best;
+            pos++;
+        }
+    }
+
+  public:
+    // prefix i routes to i; throws std::runtime_error (a compile error in
+    // constant evaluation) on duplicates or prefixes longer than MaxLen
+    constexpr PrefixRouter(const std::array<std::string_view, N>& prefixes)
+        : m_prefixes(prefixes) {
+        std::array<std::uint16_t, N> order{};
+        for (std::size_t i = 0; i < N; i++) {
+            if (prefixes[i].size() > MaxLen)
+                throw std::runtime_error("PrefixRouter: prefix too long");
+            // insertion sort, std::sort is not constexpr before C++20
+            std::size_t j = i;
+            while ((j > 0) && less(prefixes[i], prefixes[order[j - 1]])) {
+                order[j] = order[j - 1];
+                j--;
+            }
+            order[j] = static_cast<std::uint16_t>(i);
+        }
+        for (std::size_t i = 1; i < N; i++) {
+            if (prefixes[order[i]] == prefixes[order[i - 1]])
+                throw std::runtime_error("PrefixRouter: duplicate prefix");
+        }
+        build(order, 0, N, 0, 0);
+    }
+
+  public:
+    // Index of the longest prefix `payload` starts with, or NO_ROUTE. The
+    // tree is descended on the branching bytes alone, then the deepest
+    // prefix reached is verified with one compare; only if that fails are
+    // the labels compared one by one.
+    constexpr int route(std::string_view payload) const {
+        int candidate = NO_ROUTE;
+        std::size_t at = 0;
+        for (;;) {
+            const Node& node = m_nodes[at];
+            if (payload.size() < node.end)
+                break;
+            if (node.route != NO_ROUTE)
+                candidate = node.route;
+            if ((node.children == 0) || (payload.size() == node.end))
+                break;
+            at = child(node, static_cast<std::uint8_t>(payload[node.end]));
+            if (at == 0)
+                break;
+        }
+        if (candidate == NO_ROUTE)
+            return NO_ROUTE;
+        std::string_view prefix = m_prefixes[candidate];
+        if (payload.substr(0, prefix.size()) == prefix)
+            return candidate;
+        return walk(payload);
+    }
+
+    // route of a masked payload: only its first max_prefix bytes are
+    // unmasked, into a local buffer
+    int route(std::string_view payload,
+              const std::array<std::uint8_t, 4>& masking_key) const {
+        std::array<char, MaxLen + 1> prefix;
+        std::size_t n = std::min(payload.size(), MaxLen);
+        apply_mask(reinterpret_cast<std::uint8_t*>(prefix.data()),
+                   reinterpret_cast<const std::uint8_t*>(payload.data()), n,
+                   masking_key, 0);
+        return route(std::string_view(prefix.data(), n));
+    }
+
+    // route of a TEXT or BINARY frame (the first of a fragmented message);
+    // NO_ROUTE for other opcodes
+    int route(const Frame& frame) const {
+        if ((frame.opcode != Frame::Opcode::TEXT) &&
+            (frame.opcode != Frame::Opcode::BINARY))
+            return NO_ROUTE;
+        if (frame.mask)
+            return route(frame.payload, frame.masking_key);
+        return route(frame.payload);
+    }
+
+    std::string_view prefix(std::size_t i) const { return m_prefixes[i]; }
+
+    std::size_t size() const { return N; }
+};
+
+// Router for a constexpr array of prefixes with static storage duration:
+//
+//   static constexpr std::array<std::string_view, 2> channels = {
+//       R"({"channel":"trades")", R"({"channel":"book")"};
+//   static constexpr auto router = wsframe::make_prefix_router<channels>();
+template <const auto& Prefixes> constexpr auto make_prefix_router() {
+    constexpr std::size_t max_len = [] {
+        std::size_t out = 0;
+        for (auto prefix : Prefixes) {
+            out = std::max(out, prefix.size());
+        }
+        return out;
+    }();
+    return PrefixRouter<std::tuple_size_v<std::decay_t<decltype(Prefixes)>>,
+                        max_len>(Prefixes);
+}
+
+// Parser hooks routing every completed TEXT/BINARY frame; route() is the
+// route of the frame just returned by update(). The router must outlive
+// the parser. Other hooks are those of `Base`.
+template <typename Router, typename Base = NullHooks>
+class RouteHooks : public Base {
+  private:
+    const Router* m_router;
+    int m_route = Router::NO_ROUTE;
+
+  public:
+    RouteHooks(const Router& router, Base base = Base())
+        : Base(std::move(base)), m_router(&router) {}
+
+    void on_frame_complete(const Frame& frame, std::size_t header_len) {
+        Base::on_frame_complete(frame, header_len);
+        m_route = m_router->route(frame);
+    }
+
+    int route() const { return m_route; }
+};
+
+} // namespace wsframe
+
+#endif // _WSFRAME_ROUTER_HPP_
@@ -3,9 +3,14 @@
 
 #include <algorithm>
 #include <array>
+#include <atomic>
 #include <cstdint>
 #include <cstring>
+#include <deque>
+#include <functional>
 #include <iostream>
+#include <memory>
+#include <mutex>
 #include <optional>
 #include <random>
 #include <stdexcept>
@@ -13,11 +18,43 @@
 #include <string_view>
 #include <vector>
 
+// Define WSFRAME_PERF_COUNTERS to attribute hardware counters (cycles,
+// instructions, branch and cache misses) to each parse stage and encoded
+// header size, see perf_counters.hpp. Compiled out otherwise.
+#ifdef WSFRAME_PERF_COUNTERS
+#include "perf_counters.hpp"
+#define WSFRAME_PERF_SCOPE(region)                                             \
+    ::wsframe::perf::Scope _wsframe_perf_scope(region)
+#else
+#define WSFRAME_PERF_SCOPE(region)
+#endif
+
+// Define WSFRAME_USDT to place Linux USDT static probes (provider "wsframe")
+// at frame boundaries so bpftrace/perf can attach to a running process.
+// Needs <sys/sdt.h> (systemtap-sdt-dev); probes are single nops until traced.
+#ifdef WSFRAME_USDT
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define WSFRAME_PROBE0(name) DTRACE_PROBE(wsframe, name)
+#define WSFRAME_PROBE1(name, a) DTRACE_PROBE1(wsframe, name, a)
+#define WSFRAME_PROBE2(name, a, b) DTRACE_PROBE2(wsframe, name, a, b)
+#define WSFRAME_PROBE3(name, a, b, c) DTRACE_PROBE3(wsframe, name, a, b, c)
+#else
+#error "WSFRAME_USDT requires <sys/sdt.h>"
+#endif
+#else
+#define WSFRAME_PROBE0(name)
+#define WSFRAME_PROBE1(name, a)
+#define WSFRAME_PROBE2(name, a, b)
+#define WSFRAME_PROBE3(name, a, b, c)
+#endif
+
 namespace wsframe {
 
-// slow! use for seeds
+// slow! use for seeds; one engine per thread so factories can be created
+// concurrently
 inline uint64_t device_random() {
-    static std::mt19937 rng(std::random_device{}());
+    static thread_local std::mt19937 rng(std::random_device{}());
     std::uniform_int_distribution<std::uint64_t> dist;
     return dist(rng);
 }
@@ -91,9 +128,11 @@ class FrameBuffer {
 
     void reset() { m_ptr = 0; }
 
+    // grows at least geometrically, so appending in small steps
+    // reallocates O(log n) times
     void ensure_fit(std::size_t sz) {
         if (capacity() < sz) {
-            m_buf.resize(sz);
+            m_buf.resize(std::max(sz, capacity() * 2));
         }
     }
 
@@ -134,6 +173,12 @@ class FrameBuffer {
 
     std::size_t size() const { return m_ptr; }
 
+    // exchange storage; views into either buffer stay valid and follow it
+    void swap(FrameBuffer& other) noexcept {
+        m_buf.swap(other.m_buf);
+        std::swap(m_ptr, other.m_ptr);
+    }
+
     template <typename T> T view() const;
 };
 
@@ -147,6 +192,31 @@ inline std::string_view FrameBuffer::view<std::string_view>() const {
     return std::string_view((const char*)m_buf.data(), m_ptr);
 }
 
+// dst[i] = src[i] ^ key[(key_offset + i) % 4], eight bytes at a time; dst
+// may equal src
+inline void apply_mask(std::uint8_t* dst, const std::uint8_t* src,
+                       std::size_t len, const std::array<std::uint8_t, 4>& key,
+                       std::size_t key_offset = 0) {
+    std::uint8_t rotated[8];
+    for (std::size_t i = 0; i < 8; i++) {
+        rotated[i] = key[(key_offset + i) % 4];
+    }
+    std::uint64_t key64;
+    std::memcpy(&key64, rotated, 8);
+    std::size_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        std::uint64_t word;
+        std::memcpy(&word, src + i, 8);
+        word ^= key64;
+        std::memcpy(dst + i, &word, 8);
+    }
+    for (; i < len; i++) {
+        dst[i] = src[i] ^ rotated[i % 8];
+    }
+}
+
+template <typename Hooks> class BasicFrameFactory;
+
 struct Frame {
     enum class Opcode : uint8_t {
         CONTINUATION = 0x0,
@@ -180,13 +250,23 @@ struct Frame {
     bool fin;
     bool mask;
     Opcode opcode;
+    // RSV1-3 as they sit in the first header byte (0x40, 0x20, 0x10)
+    std::uint8_t rsv = 0;
     std::array<std::uint8_t, 4> masking_key;
     std::string_view payload;
+    // Arrival times of the chunks holding the first and last byte of the
+    // frame, in whatever unit was passed to FrameParser::update. Zero unless
+    // the frame was parsed from timestamped updates.
+    std::uint64_t first_byte_time = 0;
+    std::uint64_t last_byte_time = 0;
 
     friend std::ostream& operator<<(std::ostream& stream, const Frame& frame) {
         stream << "[fin=" << frame.fin << "]["
                << Frame::opcode_to_string(frame.opcode)
                << "][mask=" << frame.mask << "]";
+        if (frame.rsv) {
+            stream << "[rsv=" << (frame.rsv >> 4) << "]";
+        }
         if (frame.mask) {
             stream << "[key=" << std::hex << frame.masking_key[0] << " "
                    << frame.masking_key[1] << " " << frame.masking_key[2] << " "
@@ -198,14 +278,28 @@ struct Frame {
         return stream;
     }
 
-  protected:
-    void construct(FrameBuffer& buf) const {
-        buf.reset();
-        buf.ensure_fit(payload.length() + 14 + 100);
+    // fin + rsv + opcode, mask bit + length, up to 8 length bytes and a key
+    static constexpr std::size_t MAX_HEADER_SIZE = 14;
+
+    // Size of a header given its second byte (mask bit + 7-bit length)
+    static std::size_t header_size(std::uint8_t second_byte) {
+        std::size_t len = second_byte & 0x7F;
+        std::size_t out = 2 + ((second_byte & 0x80) ? 4 : 0);
+        if (len == 126)
+            return out + 2;
+        if (len == 127)
+            return out + 8;
+        return out;
+    }
+
+    // Write the header for this frame (up to MAX_HEADER_SIZE bytes) to `out`
+    // and return its size
+    std::size_t write_header(std::uint8_t* out) const {
+        std::uint8_t* ptr = out;
 
         // fin bit + 3 rsv bits + opcode
-        buf.push_back(
-            ((fin ? 0x80 : 0x00) | (static_cast<std::uint8_t>(opcode) & 0x0F)));
+        *ptr++ = ((fin ? 0x80 : 0x00) | (rsv & 0x70) |
+                  (static_cast<std::uint8_t>(opcode) & 0x0F));
 
         // mask bit + payload length
         //   if payload.len < 126, len fits in 7 bits
@@ -214,46 +308,647 @@ struct Frame {
         const std::uint8_t mask_bit = mask ? 0x80 : 0x00;
 
         std::uint64_t payload_length = payload.length();
-        auto* payload_data = payload.data();
 
         if (payload_length < 126U) {
-            buf.push_back(mask_bit | static_cast<std::uint8_t>(payload_length));
+            *ptr++ = mask_bit | static_cast<std::uint8_t>(payload_length);
         } else if (payload_length <= 0xFFFFU) {
-            buf.push_back(mask_bit | 126U);
+            *ptr++ = mask_bit | 126U;
             // write length in network order (big-endian)
-            buf.push_back(
-                static_cast<std::uint8_t>((payload_length >> 8) & 0xFFU));
-            buf.push_back(static_cast<std::uint8_t>(payload_length & 0xFFU));
+            *ptr++ = static_cast<std::uint8_t>((payload_length >> 8) & 0xFFU);
+            *ptr++ = static_cast<std::uint8_t>(payload_length & 0xFFU);
         } else {
-            buf.push_back(mask_bit | 127U);
+            *ptr++ = mask_bit | 127U;
             // write length in big-endian
-            std::uint8_t* ptr = buf.get_space(8);
             for (int i = 7; i >= 0; i--) {
-                *ptr = static_cast<std::uint8_t>((payload_length >> (8 * i)) &
-                                                 0xFFU);
-                ptr++;
+                *ptr++ = static_cast<std::uint8_t>(
+                    (payload_length >> (8 * i)) & 0xFFU);
             }
         }
 
-        // if mask, write the mask bytes and then xor payload bytes with that
         if (mask) {
-
-            std::memcpy(buf.get_space(4), masking_key.data(),
+            std::memcpy(ptr, masking_key.data(),
                         masking_key.size() * sizeof(std::uint8_t));
-            std::uint8_t* ptr = buf.get_space(payload_length);
-            for (std::size_t i = 0; i < payload_length; i++) {
-                ptr[i] = payload_data[i] ^ masking_key[i % 4];
-            }
-        } else {
+            ptr += masking_key.size();
+        }
+        return ptr - out;
+    }
+
+  protected:
+    void construct(FrameBuffer& buf) const {
+        buf.reset();
+        buf.ensure_fit(payload.length() + 14 + 100);
+        buf.claim_space(write_header(buf.tail()));
+
+        std::uint64_t payload_length = payload.length();
+        auto* payload_data = payload.data();
+
+        // if mask, xor payload bytes with the key written in the header
+        if (mask) {
+            apply_mask(buf.get_space(payload_length),
+                       reinterpret_cast<const std::uint8_t*>(payload_data),
+                       payload_length, masking_key);
+        } else if (payload_length > 0) {
             // otherwise, just write payload
             std::memcpy(buf.get_space(payload_length), payload_data,
                         payload_length * sizeof(std::uint8_t));
         }
     }
-    friend class FrameFactory;
+    template <typename Hooks> friend class BasicFrameFactory;
+};
+
+// Decoded header of a frame whose payload may still be on its way
+struct FrameHeader {
+    bool fin;
+    bool mask;
+    Frame::Opcode opcode;
+    std::uint8_t rsv;
+    std::array<std::uint8_t, 4> masking_key;
+    std::uint64_t payload_len;
+    std::size_t header_len;
+
+    std::uint64_t frame_len() const { return header_len + payload_len; }
+
+    // Decode a header from `size` contiguous bytes; returns its length, or
+    // 0 if the bytes hold only part of it
+    static std::size_t decode(const std::uint8_t* data, std::size_t size,
+                              FrameHeader& out) {
+        if (size < 2)
+            return 0;
+        std::size_t header_len = Frame::header_size(data[1]);
+        if (size < header_len)
+            return 0;
+        out.fin = data[0] & 0x80;
+        out.rsv = data[0] & 0x70;
+        out.opcode = static_cast<Frame::Opcode>(data[0] & 0x0F);
+        out.mask = data[1] & 0x80;
+        std::uint64_t len = data[1] & 0x7F;
+        if (len == 126) {
+            len = (std::uint64_t(data[2]) << 8) | data[3];
+        } else if (len == 127) {
+            len = 0;
+            for (int i = 0; i < 8; i++) {
+                len = (len << 8) | data[2 + i];
+            }
+        }
+        out.payload_len = len;
+        out.header_len = header_len;
+        out.masking_key = {};
+        if (out.mask)
+            std::memcpy(out.masking_key.data(), data + header_len - 4, 4);
+        return header_len;
+    }
+};
+
+// Status codes of CLOSE frames (RFC 6455 7.4.1)
+enum class CloseCode : std::uint16_t {
+    NORMAL = 1000,
+    GOING_AWAY = 1001,
+    PROTOCOL_ERROR = 1002,
+    UNSUPPORTED_DATA = 1003,
+    // reported for a CLOSE frame without payload, never sent
+    NO_STATUS = 1005,
+    // reported when the connection drops without a CLOSE frame, never sent
+    ABNORMAL = 1006,
+    INVALID_PAYLOAD = 1007,
+    POLICY_VIOLATION = 1008,
+    MESSAGE_TOO_BIG = 1009,
+    MANDATORY_EXTENSION = 1010,
+    INTERNAL_ERROR = 1011,
+    // registered with IANA since
+    SERVICE_RESTART = 1012,
+    TRY_AGAIN_LATER = 1013,
+    BAD_GATEWAY = 1014
 };
 
-class FrameFactory {
+// Status code and reason of a CLOSE frame, decoded without allocating
+class CloseStatus {
+  public:
+    // a control payload is at most 125 bytes, 2 of which hold the code
+    static constexpr std::size_t MAX_REASON = 123;
+
+  private:
+    std::uint16_t m_code = static_cast<std::uint16_t>(CloseCode::NO_STATUS);
+    // view into the payload of an unmasked frame
+    std::string_view m_reason;
+    // reason of a masked frame, unmasked
+    bool m_unmasked = false;
+    std::array<char, MAX_REASON> m_buf;
+
+  public:
+    // Codes a CLOSE frame may carry (RFC 6455 7.4): the ones defined for
+    // the protocol (1004-1006 and 1015 are reserved or for reporting only),
+    // 3000-3999 for libraries and frameworks, 4000-4999 for applications
+    static constexpr bool valid(std::uint16_t code) {
+        return ((code >= 1000) && (code <= 1003)) ||
+               ((code >= 1007) && (code <= 1014)) ||
+               ((code >= 3000) && (code <= 4999));
+    }
+
+    static constexpr bool valid(CloseCode code) {
+        return valid(static_cast<std::uint16_t>(code));
+    }
+
+    // Decode the payload of a CLOSE frame. An empty payload decodes to
+    // NO_STATUS. Throws std::runtime_error for other opcodes, a 1 byte or
+    // oversized payload and codes that are not valid(), which all call for
+    // closing with PROTOCOL_ERROR. The reason is not checked for UTF-8.
+    static CloseStatus decode(const Frame& frame) {
+        if (frame.opcode != Frame::Opcode::CLOSE)
+            throw std::runtime_error("Not a close frame");
+        std::string_view payload = frame.payload;
+        if ((payload.size() == 1) || (payload.size() > 2 + MAX_REASON))
+            throw std::runtime_error("Invalid close frame payload length");
+        CloseStatus out;
+        if (payload.empty())
+            return out;
+        auto* data = reinterpret_cast<const std::uint8_t*>(payload.data());
+        std::uint8_t code[2] = {data[0], data[1]};
+        if (frame.mask) {
+            apply_mask(code, code, 2, frame.masking_key);
+            apply_mask(reinterpret_cast<std::uint8_t*>(out.m_buf.data()),
+                       data + 2, payload.size() - 2, frame.masking_key, 2);
+            out.m_unmasked = true;
+        }
+        out.m_code = static_cast<std::uint16_t>((code[0] << 8) | code[1]);
+        if (!valid(out.m_code))
+            throw std::runtime_error("Invalid close status code");
+        out.m_reason = payload.substr(2);
+        return out;
+    }
+
+    std::uint16_t code() const { return m_code; }
+
+    // valid while the frame's payload is, for unmasked frames
+    std::string_view reason() const {
+        if (m_unmasked)
+            return std::string_view(m_buf.data(), m_reason.size());
+        return m_reason;
+    }
+};
+
+// Packed description of a parsed frame whose payload is in a parser's
+// buffer, see BasicFrameParser::parse_batch: the two leading header bytes
+// and the payload position. The masking key, if any, precedes the payload.
+struct FrameDescriptor {
+    // payload offset in the parser buffer and length
+    std::uint32_t offset;
+    std::uint32_t length;
+    // fin, rsv and opcode
+    std::uint8_t first_byte;
+    // mask bit and 7 bit length
+    std::uint8_t second_byte;
+    std::uint8_t header_len;
+    std::uint8_t reserved;
+
+    bool fin() const { return first_byte & 0x80; }
+    bool mask() const { return second_byte & 0x80; }
+    std::uint8_t rsv() const { return first_byte & 0x70; }
+
+    Frame::Opcode opcode() const {
+        return static_cast<Frame::Opcode>(first_byte & 0x0F);
+    }
+};
+static_assert(sizeof(FrameDescriptor) == 12, "");
+
+// Receive times of a frame described by a FrameDescriptor, as
+// Frame::first_byte_time/last_byte_time
+struct FrameTimes {
+    std::uint64_t first_byte_time;
+    std::uint64_t last_byte_time;
+};
+
+// Free list of FrameBuffers shared by parsers and the OwnedFrames detached
+// from them, which may be released on other threads
+class FrameBufferPool {
+  private:
+    mutable std::mutex m_mutex;
+    std::vector<FrameBuffer> m_free;
+    std::size_t m_initial_capacity;
+    std::size_t m_max_free;
+
+  public:
+    // keeps at most `max_free` idle buffers, new ones start with
+    // `initial_capacity` bytes
+    FrameBufferPool(std::size_t initial_capacity = 4096,
+                    std::size_t max_free = 16)
+        : m_initial_capacity(initial_capacity), m_max_free(max_free) {
+        // release() must not allocate
+        m_free.reserve(max_free);
+    }
+
+    FrameBuffer acquire() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (!m_free.empty()) {
+                FrameBuffer out = std::move(m_free.back());
+                m_free.pop_back();
+                return out;
+            }
+        }
+        return FrameBuffer(m_initial_capacity);
+    }
+
+    void release(FrameBuffer&& buffer) {
+        buffer.reset();
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_free.size() < m_max_free)
+            m_free.push_back(std::move(buffer));
+    }
+
+    std::size_t idle() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_free.size();
+    }
+};
+
+// A parsed frame that owns the buffer holding its payload, see
+// BasicFrameParser::detach. Move-only; moving it does not move the payload.
+// The buffer goes back to its pool on destruction.
+class OwnedFrame {
+  private:
+    Frame m_frame{};
+    FrameBuffer m_buffer{0};
+    std::shared_ptr<FrameBufferPool> m_pool;
+
+    void recycle() {
+        if (m_pool)
+            m_pool->release(std::move(m_buffer));
+        m_pool.reset();
+    }
+
+  public:
+    OwnedFrame() = default;
+
+    OwnedFrame(const Frame& frame, FrameBuffer&& buffer,
+               std::shared_ptr<FrameBufferPool> pool)
+        : m_frame(frame), m_buffer(std::move(buffer)), m_pool(std::move(pool)) {
+    }
+
+    OwnedFrame(OwnedFrame&& other) noexcept = default;
+
+    OwnedFrame& operator=(OwnedFrame&& other) noexcept {
+        if (this != &other) {
+            recycle();
+            m_frame = other.m_frame;
+            m_buffer = std::move(other.m_buffer);
+            m_pool = std::move(other.m_pool);
+        }
+        return *this;
+    }
+
+    OwnedFrame(const OwnedFrame&) = delete;
+    OwnedFrame& operator=(const OwnedFrame&) = delete;
+
+    ~OwnedFrame() { recycle(); }
+
+    // false if default constructed or moved from
+    explicit operator bool() const { return m_pool != nullptr; }
+
+    const Frame& frame() const { return m_frame; }
+    const Frame& operator*() const { return m_frame; }
+    const Frame* operator->() const { return &m_frame; }
+
+    std::string_view payload() const { return m_frame.payload; }
+};
+
+// Default hooks policy for BasicFrameParser and BasicFrameFactory. Every hook
+// is an empty inline function, so the default FrameParser and FrameFactory
+// compile as if there were no hooks at all. To observe events, derive from
+// NullHooks, hide the hooks of interest and instantiate the parser/factory
+// with the derived type; the instance is reachable through hooks().
+struct NullHooks {
+    // parser: header of the current frame decoded, payload not yet read
+    void on_frame_header(const Frame& /*frame*/,
+                         std::uint64_t /*payload_len*/) {}
+
+    // parser: frame complete, about to be returned by update()
+    void on_frame_complete(const Frame& /*frame*/,
+                           std::size_t /*header_len*/) {}
+
+    // parser: frame buffer reallocated to fit incoming data
+    void on_buffer_grow(std::size_t /*old_capacity*/,
+                        std::size_t /*new_capacity*/) {}
+
+    // parser: buffer full, bytes of the current frame moved to its front
+    void on_buffer_compact(std::size_t /*moved*/) {}
+
+    // parser: update() ran out of data in the middle of a header, decoding
+    // resumes with the next chunk
+    void on_partial_header(std::size_t /*header_bytes*/) {}
+
+    // factory: frame written to the output buffer
+    void on_frame_encoded(const Frame& /*frame*/,
+                          std::size_t /*frame_len*/) {}
+
+    // factory: masking key cache refilled
+    void on_key_refill() {}
+};
+
+// Counter written by the thread owning a parser/factory and sampled by any
+// other thread. The single writer uses a relaxed load + store rather than an
+// atomic read-modify-write, so counting costs a plain add on the hot path.
+class StatCounter {
+  private:
+    std::atomic<std::uint64_t> m_value{0};
+
+  public:
+    StatCounter() {}
+    StatCounter(const StatCounter& other) : m_value(other.load()) {}
+
+    void add(std::uint64_t n) {
+        m_value.store(m_value.load(std::memory_order_relaxed) + n,
+                      std::memory_order_relaxed);
+    }
+
+    void set_max(std::uint64_t n) {
+        if (n > m_value.load(std::memory_order_relaxed))
+            m_value.store(n, std::memory_order_relaxed);
+    }
+
+    std::uint64_t load() const {
+        return m_value.load(std::memory_order_relaxed);
+    }
+};
+
+// Hooks policy counting what a BasicFrameParser does:
+//   BasicFrameParser<ParserStats> parser;
+//   ParserStats::Snapshot total;
+//   parser.hooks().sample_into(total); // from any thread
+class ParserStats : public NullHooks {
+  public:
+    struct Snapshot {
+        std::array<std::uint64_t, 16> frames{};
+        std::uint64_t payload_bytes = 0;
+        std::uint64_t header_bytes = 0;
+        std::uint64_t buffer_grows = 0;
+        std::uint64_t peak_capacity = 0;
+        std::uint64_t compacted_bytes = 0;
+        std::uint64_t partial_headers = 0;
+
+        std::uint64_t total_frames() const {
+            std::uint64_t out = 0;
+            for (auto n : frames) {
+                out += n;
+            }
+            return out;
+        }
+
+        std::uint64_t frames_with(Frame::Opcode opcode) const {
+            return frames[static_cast<std::uint8_t>(opcode) & 0x0F];
+        }
+    };
+
+  private:
+    // indexed by the 4-bit opcode
+    std::array<StatCounter, 16> m_frames;
+    StatCounter m_payload_bytes;
+    StatCounter m_header_bytes;
+    StatCounter m_buffer_grows;
+    StatCounter m_peak_capacity;
+    StatCounter m_compacted_bytes;
+    StatCounter m_partial_headers;
+
+  public:
+    void on_frame_complete(const Frame& frame, std::size_t header_len) {
+        m_frames[static_cast<std::uint8_t>(frame.opcode) & 0x0F].add(1);
+        m_payload_bytes.add(frame.payload.size());
+        m_header_bytes.add(header_len);
+    }
+
+    void on_buffer_grow(std::size_t /*old_capacity*/,
+                        std::size_t new_capacity) {
+        m_buffer_grows.add(1);
+        m_peak_capacity.set_max(new_capacity);
+    }
+
+    void on_buffer_compact(std::size_t moved) { m_compacted_bytes.add(moved); }
+
+    void on_partial_header(std::size_t /*header_bytes*/) {
+        m_partial_headers.add(1);
+    }
+
+    // Adds this instance's counters to `total`. Only relaxed loads, so a
+    // metrics thread can sweep many instances without disturbing them.
+    void sample_into(Snapshot& total) const {
+        for (std::size_t i = 0; i < 16; i++) {
+            total.frames[i] += m_frames[i].load();
+        }
+        total.payload_bytes += m_payload_bytes.load();
+        total.header_bytes += m_header_bytes.load();
+        total.buffer_grows += m_buffer_grows.load();
+        total.peak_capacity =
+            std::max(total.peak_capacity, m_peak_capacity.load());
+        total.compacted_bytes += m_compacted_bytes.load();
+        total.partial_headers += m_partial_headers.load();
+    }
+
+    Snapshot snapshot() const {
+        Snapshot out;
+        sample_into(out);
+        return out;
+    }
+};
+
+// Hooks policy counting what a BasicFrameFactory does, see ParserStats
+class FactoryStats : public NullHooks {
+  public:
+    struct Snapshot {
+        std::array<std::uint64_t, 16> frames{};
+        std::uint64_t payload_bytes = 0;
+        std::uint64_t header_bytes = 0;
+        std::uint64_t key_refills = 0;
+
+        std::uint64_t total_frames() const {
+            std::uint64_t out = 0;
+            for (auto n : frames) {
+                out += n;
+            }
+            return out;
+        }
+
+        std::uint64_t frames_with(Frame::Opcode opcode) const {
+            return frames[static_cast<std::uint8_t>(opcode) & 0x0F];
+        }
+    };
+
+  private:
+    std::array<StatCounter, 16> m_frames;
+    StatCounter m_payload_bytes;
+    StatCounter m_header_bytes;
+    StatCounter m_key_refills;
+
+  public:
+    void on_frame_encoded(const Frame& frame, std::size_t frame_len) {
+        m_frames[static_cast<std::uint8_t>(frame.opcode) & 0x0F].add(1);
+        m_payload_bytes.add(frame.payload.size());
+        m_header_bytes.add(frame_len - frame.payload.size());
+    }
+
+    void on_key_refill() { m_key_refills.add(1); }
+
+    void sample_into(Snapshot& total) const {
+        for (std::size_t i = 0; i < 16; i++) {
+            total.frames[i] += m_frames[i].load();
+        }
+        total.payload_bytes += m_payload_bytes.load();
+        total.header_bytes += m_header_bytes.load();
+        total.key_refills += m_key_refills.load();
+    }
+
+    Snapshot snapshot() const {
+        Snapshot out;
+        sample_into(out);
+        return out;
+    }
+};
+
+// A negotiated payload transform (compression, an application cipher, a
+// checksum, ...). Each extension claims one or more RSV bits and is applied
+// to whole data frame payloads by an ExtensionPipeline.
+class Extension {
+  public:
+    static constexpr std::uint8_t RSV1 = 0x40;
+    static constexpr std::uint8_t RSV2 = 0x20;
+    static constexpr std::uint8_t RSV3 = 0x10;
+
+    virtual ~Extension() = default;
+
+    // RSV bits set on frames this extension has transformed
+    virtual std::uint8_t rsv_bits() const = 0;
+
+    // Length preserving transforms (e.g. stream ciphers) return true and
+    // implement the *_in_place variants. The pipeline then rewrites the
+    // payload where it already sits instead of copying it.
+    virtual bool in_place() const { return false; }
+
+    virtual void encode_in_place(std::uint8_t* /*data*/,
+                                 std::size_t /*len*/) {}
+
+    virtual void decode_in_place(std::uint8_t* /*data*/,
+                                 std::size_t /*len*/) {}
+
+    // Write the transformed `in` to `out` (already reset) and return a view
+    // of the result. Returning (a slice of) `in` is fine when nothing needs
+    // to be written, e.g. when stripping a trailer.
+    virtual std::string_view encode(std::string_view in, FrameBuffer& out) {
+        out.push_back(in);
+        encode_in_place(out.head(), out.size());
+        return out.view<std::string_view>();
+    }
+
+    virtual std::string_view decode(std::string_view in, FrameBuffer& out) {
+        out.push_back(in);
+        decode_in_place(out.head(), out.size());
+        return out.view<std::string_view>();
+    }
+};
+
+// Chains extensions in negotiation order. Outbound payloads go through the
+// extensions first to last, inbound payloads last to first. Stages ping-pong
+// between two pooled buffers (or rewrite in place), so every stage costs at
+// most one pass over the payload and no allocations once the buffers are warm.
+class ExtensionPipeline {
+  private:
+    std::vector<Extension*> m_extensions;
+    std::array<FrameBuffer, 2> m_buffers;
+    std::uint8_t m_rsv_bits = 0;
+
+    // index of the pooled buffer holding `view`, or -1
+    int owner(std::string_view view) const {
+        auto* ptr = reinterpret_cast<const std::uint8_t*>(view.data());
+        for (int i = 0; i < 2; i++) {
+            const auto* head = m_buffers[i].head();
+            if ((ptr >= head) && (ptr < head + m_buffers[i].capacity()))
+                return i;
+        }
+        return -1;
+    }
+
+    template <bool encoding>
+    std::string_view apply(Extension& ext, std::string_view payload) {
+        int current = owner(payload);
+        if (ext.in_place() && (current >= 0)) {
+            auto& buf = m_buffers[current];
+            auto* data = buf.head() + (reinterpret_cast<const std::uint8_t*>(
+                                           payload.data()) -
+                                       buf.head());
+            if (encoding) {
+                ext.encode_in_place(data, payload.size());
+            } else {
+                ext.decode_in_place(data, payload.size());
+            }
+            return payload;
+        }
+        auto& out = m_buffers[current == 0 ? 1 : 0];
+        out.reset();
+        if (encoding)
+            return ext.encode(payload, out);
+        return ext.decode(payload, out);
+    }
+
+  public:
+    ExtensionPipeline(std::size_t initial_capacity = 4096)
+        : m_buffers{FrameBuffer(initial_capacity),
+                    FrameBuffer(initial_capacity)} {}
+
+    // The pipeline does not own the extension, which must outlive it
+    void add(Extension& ext) {
+        std::uint8_t bits = ext.rsv_bits();
+        if ((bits == 0) || (bits & ~0x70)) {
+            throw std::runtime_error("Extensions must claim RSV1-3 bits only");
+        }
+        if (bits & m_rsv_bits) {
+            throw std::runtime_error("RSV bit already claimed by an extension");
+        }
+        m_rsv_bits |= bits;
+        m_extensions.push_back(&ext);
+    }
+
+    bool empty() const { return m_extensions.empty(); }
+
+    std::uint8_t rsv_bits() const { return m_rsv_bits; }
+
+    // Result is valid until the next encode/decode call
+    std::string_view encode(std::string_view payload) {
+        for (auto* ext : m_extensions) {
+            payload = apply<true>(*ext, payload);
+        }
+        return payload;
+    }
+
+    // Undo the extensions whose bits are set in `rsv`. Result is valid until
+    // the next encode/decode call.
+    std::string_view decode(std::string_view payload, std::uint8_t rsv) {
+        if (rsv & ~m_rsv_bits) {
+            throw std::runtime_error("Frame uses RSV bits that were not "
+                                     "negotiated");
+        }
+        for (auto it = m_extensions.rbegin(); it != m_extensions.rend();
+             it++) {
+            if (rsv & (*it)->rsv_bits())
+                payload = apply<false>(**it, payload);
+        }
+        return payload;
+    }
+
+    // Masked frames are unmasked into a pooled buffer first, so the result
+    // is always the unmasked payload, whether or not an extension applied
+    std::string_view decode(const Frame& frame) {
+        std::string_view payload = frame.payload;
+        if (frame.mask) {
+            auto& out = m_buffers[owner(payload) == 0 ? 1 : 0];
+            out.reset();
+            out.ensure_fit(payload.size());
+            apply_mask(out.get_space(payload.size()),
+                       reinterpret_cast<const std::uint8_t*>(payload.data()),
+                       payload.size(), frame.masking_key);
+            payload = out.view<std::string_view>();
+        }
+        return decode(payload, frame.rsv);
+    }
+};
+
+template <typename Hooks = NullHooks> class BasicFrameFactory {
   private:
     template <int entries> class RandomCache {
       private:
@@ -266,41 +961,75 @@ class FrameFactory {
             fill_cache();
         }
 
+        void seed(std::uint64_t seed1, std::uint64_t seed2) {
+            m_random = XorShift128Plus(seed1, seed2);
+            fill_cache();
+        }
+
         void fill_cache() {
             m_random.fill_bytes(m_cache);
             m_cache_ptr = 0;
         }
 
-        void get(std::array<uint8_t, 4>& ptr) {
+        // returns true if the cache had to be refilled first
+        bool get(std::array<uint8_t, 4>& ptr) {
+            bool refilled = false;
             if (m_cache_ptr >= entries * 4) {
                 fill_cache();
+                refilled = true;
             }
             std::copy(&m_cache[m_cache_ptr], &m_cache[m_cache_ptr + 4],
                       &ptr[0]);
             m_cache_ptr += 4;
+            return refilled;
         }
     };
 
     FrameBuffer m_buf;
     RandomCache<8> m_random;
+    Hooks m_hooks;
+
+    void key_refilled() {
+        WSFRAME_PROBE0(key_refill);
+        m_hooks.on_key_refill();
+    }
 
   public:
-    FrameFactory(std::size_t initial_capacity = 4096)
-        : m_buf(initial_capacity) {}
+    BasicFrameFactory(std::size_t initial_capacity = 4096,
+                      Hooks hooks = Hooks())
+        : m_buf(initial_capacity), m_hooks(std::move(hooks)) {}
 
-    void fill_random_cache() { m_random.fill_cache(); }
+    Hooks& hooks() { return m_hooks; }
+    const Hooks& hooks() const { return m_hooks; }
+
+    void fill_random_cache() {
+        m_random.fill_cache();
+        key_refilled();
+    }
+
+    // Masking keys are seeded from std::random_device; reseed for
+    // reproducible output
+    void seed_random(std::uint64_t seed1, std::uint64_t seed2) {
+        m_random.seed(seed1, seed2);
+    }
 
     std::string_view construct(bool fin, Frame::Opcode opcode, bool mask,
-                               std::string_view payload) {
+                               std::string_view payload,
+                               std::uint8_t rsv = 0) {
         Frame frame;
         frame.fin = fin;
         frame.mask = mask;
         frame.opcode = opcode;
-        if (mask) {
-            m_random.get(frame.masking_key);
+        frame.rsv = rsv;
+        WSFRAME_PERF_SCOPE(::wsframe::perf::encode_region(payload.size()));
+        if (mask && m_random.get(frame.masking_key)) {
+            key_refilled();
         }
         frame.payload = payload;
         frame.construct(m_buf);
+        WSFRAME_PROBE3(frame_encoded, static_cast<int>(opcode),
+                       frame.payload.size(), m_buf.size());
+        m_hooks.on_frame_encoded(frame, m_buf.size());
         return m_buf.view<std::string_view>();
     }
 
@@ -312,6 +1041,22 @@ class FrameFactory {
         return construct(fin, Frame::Opcode::BINARY, mask, payload);
     }
 
+    // Run the payload through the negotiated extensions and flag the frame
+    // with their RSV bits. To fragment a transformed message, encode it once
+    // with ExtensionPipeline::encode and only set the RSV bits on the first
+    // fragment.
+    std::string_view text(bool fin, bool mask, std::string_view payload,
+                          ExtensionPipeline& extensions) {
+        return construct(fin, Frame::Opcode::TEXT, mask,
+                         extensions.encode(payload), extensions.rsv_bits());
+    }
+
+    std::string_view binary(bool fin, bool mask, std::string_view payload,
+                            ExtensionPipeline& extensions) {
+        return construct(fin, Frame::Opcode::BINARY, mask,
+                         extensions.encode(payload), extensions.rsv_bits());
+    }
+
     std::string_view ping(bool mask, std::string_view payload) {
         if (payload.size() > 125) {
             throw std::runtime_error(
@@ -335,9 +1080,55 @@ class FrameFactory {
         }
         return construct(true, Frame::Opcode::CLOSE, mask, payload);
     }
+
+    // CLOSE frame carrying a status code and a reason (UTF-8, at most
+    // CloseStatus::MAX_REASON bytes), encoded straight into the frame buffer
+    std::string_view close(bool mask, std::uint16_t code,
+                           std::string_view reason = {}) {
+        if (!CloseStatus::valid(code))
+            throw std::runtime_error("Invalid close status code");
+        if (reason.size() > CloseStatus::MAX_REASON) {
+            throw std::runtime_error(
+                "Reason should be <= 123 bytes for close frames");
+        }
+        Frame frame;
+        frame.fin = true;
+        frame.mask = mask;
+        frame.opcode = Frame::Opcode::CLOSE;
+        std::size_t payload_len = 2 + reason.size();
+        WSFRAME_PERF_SCOPE(::wsframe::perf::encode_region(payload_len));
+        if (mask && m_random.get(frame.masking_key)) {
+            key_refilled();
+        }
+        m_buf.reset();
+        m_buf.ensure_fit(Frame::MAX_HEADER_SIZE + payload_len);
+        // the payload follows a 2 byte header and the key, if any
+        std::uint8_t* payload = m_buf.tail() + (mask ? 6 : 2);
+        payload[0] = static_cast<std::uint8_t>(code >> 8);
+        payload[1] = static_cast<std::uint8_t>(code & 0xFF);
+        if (!reason.empty())
+            std::memcpy(payload + 2, reason.data(), reason.size());
+        frame.payload = std::string_view(reinterpret_cast<const char*>(payload),
+                                         payload_len);
+        m_buf.claim_space(frame.write_header(m_buf.tail()));
+        if (mask)
+            apply_mask(payload, payload, payload_len, frame.masking_key);
+        m_buf.claim_space(payload_len);
+        WSFRAME_PROBE3(frame_encoded, static_cast<int>(frame.opcode),
+                       payload_len, m_buf.size());
+        m_hooks.on_frame_encoded(frame, m_buf.size());
+        return m_buf.view<std::string_view>();
+    }
+
+    std::string_view close(bool mask, CloseCode code,
+                           std::string_view reason = {}) {
+        return close(mask, static_cast<std::uint16_t>(code), reason);
+    }
 };
 
-class FrameParser {
+using FrameFactory = BasicFrameFactory<>;
+
+template <typename Hooks = NullHooks> class BasicFrameParser {
   private:
     enum class ParseStage {
         FIN_BIT,
@@ -348,13 +1139,119 @@ class FrameParser {
         EXTENDED_PAYLOAD_LEN_64,
         MASKING_KEY,
         PAYLOAD_DATA,
+        // payload of a frame rejected by the filter, dropped as it arrives
+        SKIP_PAYLOAD,
+        // payload copied (and unmasked) into a caller supplied destination
+        DIRECT_PAYLOAD,
         DONE
     };
     ParseStage m_parse_stage = ParseStage::FIN_BIT;
     Frame m_frame;
     FrameBuffer m_frame_buffer;
     std::uint64_t m_payload_len = 0;
+    std::size_t m_header_len = 0;
     std::size_t m_ptr = 0;
+    // buffer offset of the current frame's first byte
+    std::size_t m_frame_start = 0;
+    Hooks m_hooks;
+
+    std::function<bool(const FrameHeader&)> m_filter;
+    std::uint64_t m_skip_left = 0;
+    std::uint64_t m_skipped_frames = 0;
+    std::uint64_t m_skipped_bytes = 0;
+
+    std::shared_ptr<FrameBufferPool> m_pool;
+
+    // frames returned so far, numbered from 0
+    std::uint64_t m_frames = 0;
+
+    // retain mode: buffers are never overwritten, compacted or grown while
+    // they hold payloads of unreleased frames (numbers >= m_released)
+    bool m_retain = false;
+    std::uint64_t m_released = 0;
+    // the current buffer holds payloads of frames up to m_buffer_last_frame
+    bool m_buffer_holds = false;
+    std::uint64_t m_buffer_last_frame = 0;
+    // retired buffers still holding unreleased frames, oldest first
+    struct Generation {
+        FrameBuffer buffer;
+        std::uint64_t last_frame;
+    };
+    std::deque<Generation> m_generations;
+
+    std::function<std::uint8_t*(const FrameHeader&)> m_destination;
+    std::uint8_t* m_direct = nullptr;
+    std::uint64_t m_direct_done = 0;
+    std::uint64_t m_direct_first_time = 0;
+    // time passed to the update being fed, for direct payloads
+    std::uint64_t m_feed_time = 0;
+
+    // arrival time of the buffered bytes up to (excluding) `end`, one entry
+    // per timestamped chunk; empty unless the timestamped updates are used
+    struct ChunkTime {
+        std::size_t end;
+        std::uint64_t time;
+    };
+    std::vector<ChunkTime> m_chunk_times;
+
+    // parse_batch: a frame too large to describe ended the last call, which
+    // returned the frames before it; the next call reports it
+    bool m_batch_overflow = false;
+
+    // auto pong mode: PONGs answering received PINGs, encoded by m_ponger
+    // and waiting to be sent from m_output_sent on
+    std::optional<BasicFrameFactory<>> m_ponger;
+    bool m_pong_mask = false;
+    FrameBuffer m_output{0};
+    std::size_t m_output_sent = 0;
+
+    void record_time(std::uint64_t time) {
+        std::size_t end = m_frame_buffer.size();
+        std::size_t n = m_chunk_times.size();
+        if ((n > 0) && (m_chunk_times.back().end >= end))
+            return;
+        // a chunk strictly inside the payload being received holds neither
+        // its frame's first or last byte nor bytes of other frames: fold it
+        // into this one instead of keeping an entry per chunk
+        if ((n >= 2) && (m_parse_stage == ParseStage::PAYLOAD_DATA) &&
+            (m_chunk_times[n - 2].end > m_frame_start) &&
+            (m_chunk_times[n - 1].end < m_ptr + m_payload_len)) {
+            m_chunk_times[n - 1] = {end, time};
+            return;
+        }
+        m_chunk_times.push_back({end, time});
+    }
+
+    std::uint64_t time_at(std::size_t offset) const {
+        for (const auto& chunk : m_chunk_times) {
+            if (offset < chunk.end)
+                return chunk.time;
+        }
+        // not recorded yet: part of the chunk being fed
+        return m_feed_time;
+    }
+
+    // frame spans [m_ptr - frame length, m_ptr)
+    void stamp_frame() {
+        // direct payloads are stamped as they complete
+        if (m_chunk_times.empty() || m_direct)
+            return;
+        m_frame.first_byte_time = time_at(m_ptr - m_header_len - m_payload_len);
+        m_frame.last_byte_time = time_at(m_ptr - 1);
+    }
+
+    // buffer offsets before `consumed` are gone after compaction
+    void drop_times(std::size_t consumed) {
+        if (m_chunk_times.empty())
+            return;
+        std::size_t keep = 0;
+        for (auto& chunk : m_chunk_times) {
+            if (chunk.end > consumed) {
+                m_chunk_times[keep++] = {chunk.end - consumed, chunk.time};
+            }
+        }
+        m_chunk_times.resize(keep);
+    }
 
     std::size_t remaining() const { return m_frame_buffer.size() - m_ptr; }
 
@@ -366,9 +1263,249 @@ class FrameParser {
         return out;
     }
 
+    // the masking key follows the payload length, if there is one
+    void payload_len_done() {
+        if (m_frame.mask) {
+            m_parse_stage = ParseStage::MASKING_KEY;
+            return;
+        }
+        header_done();
+    }
+
+    void header_done() {
+        m_parse_stage = ParseStage::PAYLOAD_DATA;
+        m_header_len = m_ptr - m_frame_start;
+        WSFRAME_PROBE2(frame_header, static_cast<int>(m_frame.opcode),
+                       m_payload_len);
+        m_hooks.on_frame_header(m_frame, m_payload_len);
+        if (m_filter && !m_filter(header())) {
+            start_skip();
+            return;
+        }
+        // pings answered by the parser stay out of caller memory
+        if (m_destination && (m_payload_len > 0) &&
+            !(m_ponger && (m_frame.opcode == Frame::Opcode::PING))) {
+            m_direct = m_destination(header());
+            if (m_direct)
+                start_direct();
+        }
+    }
+
+    FrameHeader header() const {
+        FrameHeader out;
+        out.fin = m_frame.fin;
+        out.mask = m_frame.mask;
+        out.opcode = m_frame.opcode;
+        out.rsv = m_frame.rsv;
+        out.masking_key = m_frame.masking_key;
+        out.payload_len = m_payload_len;
+        out.header_len = m_header_len;
+        return out;
+    }
+
+    // drop the payload bytes already buffered, the rest as it arrives
+    void start_skip() {
+        WSFRAME_PROBE2(frame_skipped, static_cast<int>(m_frame.opcode),
+                       m_payload_len);
+        m_skipped_frames++;
+        m_skipped_bytes += m_header_len + m_payload_len;
+        m_skip_left = m_payload_len;
+        m_parse_stage = ParseStage::SKIP_PAYLOAD;
+        check_skip_payload();
+    }
+
+    void check_skip_payload() {
+        if (m_parse_stage != ParseStage::SKIP_PAYLOAD)
+            return;
+        auto n = static_cast<std::size_t>(
+            std::min<std::uint64_t>(m_skip_left, remaining()));
+        m_ptr += n;
+        m_skip_left -= n;
+        // nothing buffered is needed any more
+        if (remaining() == 0)
+            discard_buffer();
+        if (m_skip_left == 0)
+            next_frame();
+    }
+
+    void start_direct() {
+        m_direct_done = 0;
+        m_direct_first_time = time_at(m_frame_start);
+        m_parse_stage = ParseStage::DIRECT_PAYLOAD;
+        check_direct_payload();
+    }
+
+    void copy_direct(const std::uint8_t* src, std::size_t n) {
+        std::uint8_t* dst = m_direct + m_direct_done;
+        if (m_frame.mask) {
+            apply_mask(dst, src, n, m_frame.masking_key, m_direct_done % 4);
+        } else {
+            std::memcpy(dst, src, n);
+        }
+        m_direct_done += n;
+    }
+
+    void direct_done(std::uint64_t last_time) {
+        const char* payload = reinterpret_cast<const char*>(m_direct);
+        m_frame.payload = std::string_view(payload, m_payload_len);
+        m_frame.mask = false;
+        m_frame.first_byte_time = m_direct_first_time;
+        m_frame.last_byte_time = last_time;
+        m_parse_stage = ParseStage::DONE;
+    }
+
+    void check_direct_payload() {
+        if (m_parse_stage != ParseStage::DIRECT_PAYLOAD)
+            return;
+        auto n = static_cast<std::size_t>(
+            std::min<std::uint64_t>(m_payload_len - m_direct_done,
+                                    remaining()));
+        copy_direct(m_frame_buffer.head() + m_ptr, n);
+        m_ptr += n;
+        if ((n > 0) && (m_direct_done == m_payload_len))
+            direct_done(time_at(m_ptr - 1));
+        if (remaining() == 0)
+            discard_buffer();
+    }
+
+    void next_frame() {
+        m_direct = nullptr;
+        m_frame = {};
+        m_payload_len = 0;
+        m_header_len = 0;
+        m_frame_start = m_ptr;
+        m_parse_stage = ParseStage::FIN_BIT;
+    }
+
+    // header bytes of the current frame that are not buffered yet
+    std::size_t header_missing() const {
+        std::size_t have = m_frame_buffer.size() - m_frame_start;
+        if (have < 2)
+            return 2 - have;
+        std::size_t size = Frame::header_size(
+            *(m_frame_buffer.head() + m_frame_start + 1));
+        return have < size ? size - have : 0;
+    }
+
+    // Buffer `data`. With a filter or a payload destination set, header
+    // bytes are buffered one header at a time so the payload of a rejected
+    // frame is dropped straight from `data` and a direct payload is copied
+    // from `data` to its destination, neither touching the frame buffer.
+    void feed(std::string_view data) {
+        if (!m_filter && !m_destination) {
+            append(data);
+            return;
+        }
+        while (!data.empty()) {
+            if (m_parse_stage == ParseStage::DIRECT_PAYLOAD) {
+                auto n = static_cast<std::size_t>(std::min<std::uint64_t>(
+                    m_payload_len - m_direct_done, data.size()));
+                copy_direct(reinterpret_cast<const std::uint8_t*>(data.data()),
+                            n);
+                data.remove_prefix(n);
+                if (m_direct_done == m_payload_len)
+                    direct_done(m_feed_time);
+                continue;
+            }
+            if (m_parse_stage == ParseStage::SKIP_PAYLOAD) {
+                auto n = static_cast<std::size_t>(
+                    std::min<std::uint64_t>(m_skip_left, data.size()));
+                data.remove_prefix(n);
+                m_skip_left -= n;
+                if (m_skip_left == 0)
+                    next_frame();
+                continue;
+            }
+            if (m_parse_stage >= ParseStage::PAYLOAD_DATA) {
+                append(data);
+                return;
+            }
+            std::size_t n = std::min(data.size(), header_missing());
+            append(data.substr(0, n));
+            data.remove_prefix(n);
+            check_header();
+        }
+    }
+
+    FrameBufferPool& pool() {
+        if (!m_pool)
+            m_pool = std::make_shared<FrameBufferPool>();
+        return *m_pool;
+    }
+
+    // the current buffer may be overwritten
+    bool buffer_reusable() const {
+        return !m_retain || !m_buffer_holds ||
+               (m_buffer_last_frame < m_released);
+    }
+
+    // Retain mode: continue in a pooled buffer with room for `extra` more
+    // bytes, taking along the current frame, and keep the old one until its
+    // frames are released
+    void rotate(std::size_t extra) {
+        std::size_t moved = m_frame_buffer.size() - m_frame_start;
+        FrameBuffer next = pool().acquire();
+        next.ensure_fit(std::max(moved + extra, m_frame_buffer.capacity()));
+        std::memcpy(next.get_space(moved),
+                    m_frame_buffer.head() + m_frame_start, moved);
+        drop_times(m_frame_start);
+        m_frame_buffer.swap(next);
+        m_generations.push_back({std::move(next), m_buffer_last_frame});
+        m_buffer_holds = false;
+        m_ptr -= m_frame_start;
+        m_frame_start = 0;
+    }
+
+    // Drop everything before the current frame. Only done when the buffer
+    // is full, so consecutive frames in one chunk are parsed in place.
+    void compact() {
+        std::size_t moved = m_frame_buffer.size() - m_frame_start;
+        drop_times(m_frame_start);
+        std::memmove(m_frame_buffer.head(),
+                     m_frame_buffer.head() + m_frame_start, moved);
+        WSFRAME_PROBE1(buffer_compact, moved);
+        m_hooks.on_buffer_compact(moved);
+        m_frame_buffer.reset();
+        m_frame_buffer.claim_space(moved);
+        m_ptr -= m_frame_start;
+        m_frame_start = 0;
+        m_buffer_holds = false;
+    }
+
+    // all buffered bytes have been consumed; in retain mode the next bytes
+    // are appended behind unreleased frames instead
+    void discard_buffer() {
+        if (!buffer_reusable())
+            return;
+        m_buffer_holds = false;
+        drop_times(m_ptr);
+        m_frame_buffer.reset();
+        m_ptr = 0;
+        m_frame_start = 0;
+    }
+
+    template <typename View> void append(const View& view) {
+        if ((m_frame_start > 0) && (m_frame_buffer.size() + view.size() >
+                                    m_frame_buffer.capacity())) {
+            if (buffer_reusable()) {
+                compact();
+            } else {
+                rotate(view.size());
+            }
+        }
+        std::size_t capacity = m_frame_buffer.capacity();
+        m_frame_buffer.push_back(view);
+        if (m_frame_buffer.capacity() != capacity) {
+            WSFRAME_PROBE2(buffer_grow, capacity, m_frame_buffer.capacity());
+            m_hooks.on_buffer_grow(capacity, m_frame_buffer.capacity());
+        }
+    }
+
     void check_fin_bit() {
         if ((m_parse_stage != ParseStage::FIN_BIT) || (remaining() == 0))
             return;
+        WSFRAME_PERF_SCOPE(::wsframe::perf::Region::FIN_BIT);
+        m_frame_start = m_ptr;
         m_frame.fin = read() & 0x80;
         m_parse_stage = ParseStage::OPCODE;
     }
@@ -376,13 +1513,17 @@ class FrameParser {
     void check_opcode() {
         if ((m_parse_stage != ParseStage::OPCODE) || (remaining() == 0))
             return;
-        m_frame.opcode = static_cast<Frame::Opcode>(consume() & 0x0F);
+        WSFRAME_PERF_SCOPE(::wsframe::perf::Region::OPCODE);
+        std::uint8_t byte = consume();
+        m_frame.rsv = byte & 0x70;
+        m_frame.opcode = static_cast<Frame::Opcode>(byte & 0x0F);
         m_parse_stage = ParseStage::MASK_BIT;
     }
 
     void check_mask_bit() {
         if ((m_parse_stage != ParseStage::MASK_BIT) || (remaining() == 0))
             return;
+        WSFRAME_PERF_SCOPE(::wsframe::perf::Region::MASK_BIT);
         m_frame.mask = read() & 0x80;
         m_parse_stage = ParseStage::PAYLOAD_LEN;
     }
@@ -390,6 +1531,7 @@ class FrameParser {
     void check_payload_len() {
         if ((m_parse_stage != ParseStage::PAYLOAD_LEN) || (remaining() == 0))
             return;
+        WSFRAME_PERF_SCOPE(::wsframe::perf::Region::PAYLOAD_LEN);
         std::size_t len = consume() & 0x7F;
         if (len == 126) {
             m_parse_stage = ParseStage::EXTENDED_PAYLOAD_LEN_16;
@@ -400,46 +1542,47 @@ class FrameParser {
             return;
         }
         m_payload_len = len;
-        m_parse_stage =
-            m_frame.mask ? ParseStage::MASKING_KEY : ParseStage::PAYLOAD_DATA;
+        payload_len_done();
     }
 
     void check_extended_payload_len_16() {
         if ((m_parse_stage != ParseStage::EXTENDED_PAYLOAD_LEN_16) ||
             (remaining() < 2))
             return;
+        WSFRAME_PERF_SCOPE(::wsframe::perf::Region::EXTENDED_PAYLOAD_LEN_16);
         uint64_t left = consume();
         uint64_t right = consume();
         m_payload_len = (left << 8) | right;
-        m_parse_stage =
-            m_frame.mask ? ParseStage::MASKING_KEY : ParseStage::PAYLOAD_DATA;
+        payload_len_done();
     }
 
     void check_extended_payload_len_64() {
         if ((m_parse_stage != ParseStage::EXTENDED_PAYLOAD_LEN_64) ||
             (remaining() < 8))
             return;
+        WSFRAME_PERF_SCOPE(::wsframe::perf::Region::EXTENDED_PAYLOAD_LEN_64);
         m_payload_len = 0;
         for (int i = 7; i >= 0; i--) {
-            m_payload_len |= consume() << 8 * i;
+            m_payload_len |= static_cast<std::uint64_t>(consume()) << 8 * i;
         }
-        m_parse_stage =
-            m_frame.mask ? ParseStage::MASKING_KEY : ParseStage::PAYLOAD_DATA;
+        payload_len_done();
     }
 
     void check_masking_key() {
         if ((m_parse_stage != ParseStage::MASKING_KEY) || (remaining() < 4))
             return;
+        WSFRAME_PERF_SCOPE(::wsframe::perf::Region::MASKING_KEY);
         for (int i = 0; i < 4; i++) {
             m_frame.masking_key[i] = consume();
         }
-        m_parse_stage = ParseStage::PAYLOAD_DATA;
+        header_done();
     }
 
     void check_payload_data() {
         if ((m_parse_stage != ParseStage::PAYLOAD_DATA) ||
             (remaining() < m_payload_len))
             return;
+        WSFRAME_PERF_SCOPE(::wsframe::perf::Region::PAYLOAD_DATA);
         if (m_payload_len == 0) {
             m_parse_stage = ParseStage::DONE;
             return;
@@ -452,7 +1595,7 @@ class FrameParser {
 
     bool done() const { return m_parse_stage == ParseStage::DONE; }
 
-    std::optional<Frame> parse() {
+    void check_header() {
         check_fin_bit();
         check_opcode();
         check_mask_bit();
@@ -460,78 +1603,448 @@ class FrameParser {
         check_extended_payload_len_16();
         check_extended_payload_len_64();
         check_masking_key();
-        check_payload_data();
-        if (!done())
+    }
+
+    // run the stage machine; true once a frame is complete
+    bool step() {
+        // skipping a frame leaves the stage at FIN_BIT, go on with the next
+        do {
+            check_skip_payload();
+            check_direct_payload();
+            check_header();
+            check_payload_data();
+        } while ((m_parse_stage == ParseStage::FIN_BIT) && (remaining() > 0));
+        if (!done()) {
+            if ((m_parse_stage != ParseStage::FIN_BIT) &&
+                (m_parse_stage < ParseStage::PAYLOAD_DATA)) {
+                WSFRAME_PROBE1(partial_header, m_ptr - m_frame_start);
+                m_hooks.on_partial_header(m_ptr - m_frame_start);
+            }
+            return false;
+        }
+        stamp_frame();
+        if (!m_direct) {
+            m_buffer_holds = true;
+            m_buffer_last_frame = m_frames;
+        }
+        m_frames++;
+        WSFRAME_PROBE3(frame_complete, static_cast<int>(m_frame.opcode),
+                       m_frame.payload.size(), m_header_len);
+        m_hooks.on_frame_complete(m_frame, m_header_len);
+        return true;
+    }
+
+    // after a frame was returned; leftover bytes stay where they are until
+    // the buffer fills up (see append)
+    void reset() {
+        if (remaining() == 0)
+            discard_buffer();
+        next_frame();
+    }
+
+    // auto pong mode: queue the PONG for a complete PING; false for other
+    // frames and for pings that may not be answered (fragmented, or with an
+    // oversized payload), which are returned to the caller
+    bool answer_ping() {
+        if (!m_ponger || (m_frame.opcode != Frame::Opcode::PING) ||
+            !m_frame.fin || (m_frame.payload.size() > 125))
+            return false;
+        std::string_view payload = m_frame.payload;
+        std::array<std::uint8_t, 125> unmasked;
+        if (m_frame.mask) {
+            apply_mask(unmasked.data(),
+                       reinterpret_cast<const std::uint8_t*>(payload.data()),
+                       payload.size(), m_frame.masking_key);
+            payload = std::string_view(
+                reinterpret_cast<const char*>(unmasked.data()), payload.size());
+        }
+        m_output.push_back(m_ponger->pong(m_pong_mask, payload));
+        return true;
+    }
+
+    // parse after new bytes were fed, if any; a direct payload may have
+    // completed the frame while being fed. Answered pings are passed over.
+    bool advance(bool new_data) {
+        for (;;) {
+            if ((!new_data) && (m_parse_stage != ParseStage::FIN_BIT))
+                return false;
+            if ((remaining() == 0) && !done())
+                return false;
+            if (!step())
+                return false;
+            if (!answer_ping())
+                return true;
+            reset();
+            new_data = false;
+        }
+    }
+
+    std::optional<Frame> resume(bool new_data) {
+        if (!advance(new_data))
             return {};
         return m_frame;
     }
 
-    void reset() {
-        if (remaining() > 0) {
-            auto re_space = remaining();
-            std::memmove(m_frame_buffer.head(), m_frame_buffer.head() + m_ptr,
-                         re_space);
-            m_frame_buffer.reset();
-            m_frame_buffer.claim_space(re_space);
-            m_ptr = 0;
-        } else {
-            m_frame_buffer.reset();
-            m_ptr = 0;
+    // update(bool): bytes written through frame_buffer() bypass append(), so
+    // compact here instead, once the parser waits for more bytes and those
+    // before the current frame fill half the buffer
+    std::optional<Frame> resume_written(bool new_data) {
+        if (advance(new_data))
+            return m_frame;
+        if ((m_frame_start > 0) &&
+            (m_frame_start >= m_frame_buffer.capacity() / 2) &&
+            buffer_reusable())
+            compact();
+        return {};
+    }
+
+    // the current frame's payload offset and length fit a FrameDescriptor
+    bool describable() const {
+        return (m_ptr <= UINT32_MAX) && (m_payload_len <= UINT32_MAX);
+    }
+
+    void start_batch() {
+        if (m_destination)
+            throw std::runtime_error(
+                "parse_batch: not available with a payload destination");
+        if (done())
+            reset();
+    }
+
+    std::size_t batch(bool new_data, FrameDescriptor* out, std::size_t max,
+                      FrameTimes* times) {
+        if (m_batch_overflow) {
+            m_batch_overflow = false;
+            throw std::runtime_error("parse_batch: frame beyond 4 GB");
         }
+        std::size_t n = 0;
+        while ((n < max) && advance(new_data)) {
+            if (!describable()) {
+                // hand out the frames before it, the next call reports it
+                if (n == 0)
+                    throw std::runtime_error("parse_batch: frame beyond 4 GB");
+                m_batch_overflow = true;
+                return n;
+            }
+            if (times)
+                times[n] = {m_frame.first_byte_time, m_frame.last_byte_time};
+            out[n++] = describe();
+            if (n == max)
+                break;
+            reset();
+            new_data = false;
+        }
+        return n;
+    }
 
-        m_frame = {};
-        m_payload_len = 0;
-        m_parse_stage = ParseStage::FIN_BIT;
+    FrameDescriptor describe() const {
+        const std::uint8_t* start = m_frame_buffer.head() + m_frame_start;
+        FrameDescriptor out;
+        out.offset = static_cast<std::uint32_t>(m_ptr - m_payload_len);
+        out.length = static_cast<std::uint32_t>(m_payload_len);
+        out.first_byte = start[0];
+        out.second_byte = start[1];
+        out.header_len = static_cast<std::uint8_t>(m_header_len);
+        out.reserved = 0;
+        return out;
     }
 
   public:
-    FrameParser() {}
+    BasicFrameParser(Hooks hooks = Hooks()) : m_hooks(std::move(hooks)) {}
+
+    Hooks& hooks() { return m_hooks; }
+    const Hooks& hooks() const { return m_hooks; }
 
     void clear() {
+        release_all();
         m_frame_buffer.reset();
+        m_chunk_times.clear();
         m_ptr = 0;
-        m_frame = {};
-        m_payload_len = 0;
-        m_parse_stage = ParseStage::FIN_BIT;
+        m_skip_left = 0;
+        next_frame();
+    }
+
+    // Minimum number of further bytes the current frame needs before
+    // update() can complete its header or its payload (2 when nothing of
+    // it has arrived yet); 0 while a parsed frame is waiting to be returned.
+    // Suitable for MSG_WAITALL style reads.
+    std::uint64_t bytes_needed() const {
+        switch (m_parse_stage) {
+        case ParseStage::PAYLOAD_DATA:
+            return m_payload_len -
+                   std::min<std::uint64_t>(remaining(), m_payload_len);
+        case ParseStage::SKIP_PAYLOAD:
+            return m_skip_left;
+        case ParseStage::DIRECT_PAYLOAD:
+            return m_payload_len - m_direct_done;
+        case ParseStage::DONE:
+            return 0;
+        default:
+            return header_missing();
+        }
+    }
+
+    // How much to read next: the rest of the current frame if that is
+    // larger than `min_read` (one read for a large payload), otherwise
+    // `min_read` so that several small frames arrive per read
+    std::size_t suggested_read_size(std::size_t min_read = 64 * 1024) const {
+        return static_cast<std::size_t>(
+            std::max<std::uint64_t>(bytes_needed(), min_read));
+    }
+
+    // Frames for which `filter` returns false are not returned: their
+    // payload is dropped as it arrives, without being buffered. The filter
+    // sees each header once it is complete; pass nullptr to remove it.
+    // Bytes that arrive in the same update as the end of a frame that was
+    // kept are still buffered before their header is seen.
+    void set_filter(std::function<bool(const FrameHeader&)> filter) {
+        m_filter = std::move(filter);
+    }
+
+    // Once a header is decoded, `destination` may return memory for at least
+    // payload_len bytes; the payload is then copied (and unmasked) there as
+    // it arrives, without passing through the frame buffer, and the frame
+    // is returned with mask = false and its payload pointing at it. Return
+    // nullptr to buffer a frame as usual. Pass nullptr to remove.
+    void set_payload_destination(
+        std::function<std::uint8_t*(const FrameHeader&)> destination) {
+        m_destination = std::move(destination);
+    }
+
+    // Auto pong mode: PING frames are answered by the parser instead of
+    // being returned. A PONG echoing the (unmasked) payload is appended to
+    // pending_output(), masked if `mask` is set, as clients must. Pings
+    // that may not be answered (fragmented, or over 125 bytes) are still
+    // returned. Pending output survives clear() and disabling the mode.
+    void set_auto_pong(bool enable, bool mask = false) {
+        m_pong_mask = mask;
+        if (!enable) {
+            m_ponger.reset();
+        } else if (!m_ponger) {
+            m_ponger.emplace(256);
+        }
+    }
+
+    // PONG frames waiting to be sent; valid until the next update,
+    // parse_batch or consume_output call
+    std::string_view pending_output() const {
+        return std::string_view(
+            reinterpret_cast<const char*>(m_output.head() + m_output_sent),
+            m_output.size() - m_output_sent);
+    }
+
+    // after the first `n` bytes of pending_output() were sent
+    void consume_output(std::size_t n) {
+        m_output_sent += std::min(n, m_output.size() - m_output_sent);
+        if (m_output_sent == m_output.size()) {
+            m_output.reset();
+            m_output_sent = 0;
+        }
+    }
+
+    // Retain mode: payloads of returned frames stay valid, across any number
+    // of further updates, until released with release(). Instead of being
+    // compacted or grown, a full buffer is set aside and parsing continues
+    // in one from the pool (see set_buffer_pool); set-aside buffers return
+    // to the pool as a whole once all their frames are released. Switching
+    // the mode releases all frames. Not for use with detach() or with bytes
+    // written through frame_buffer().
+    void set_retain(bool retain) {
+        release_all();
+        m_retain = retain;
     }
 
+    // number of frames returned so far; the last one returned is
+    // frame_count() - 1
+    std::uint64_t frame_count() const { return m_frames; }
+
+    // Retain mode: payloads of frames up to and including `up_to_frame` are
+    // no longer needed
+    void release(std::uint64_t up_to_frame) {
+        m_released = std::max(m_released, up_to_frame + 1);
+        while (!m_generations.empty() &&
+               (m_generations.front().last_frame < m_released)) {
+            pool().release(std::move(m_generations.front().buffer));
+            m_generations.pop_front();
+        }
+    }
+
+    void release_all() {
+        if (m_frames > 0)
+            release(m_frames - 1);
+    }
+
+    // retain mode: set-aside buffers waiting for release()
+    std::size_t retained_buffers() const { return m_generations.size(); }
+
+    // Buffers for detach(); parsers may share one. Without it, each parser
+    // creates its own on the first detach().
+    void set_buffer_pool(std::shared_ptr<FrameBufferPool> pool) {
+        m_pool = std::move(pool);
+    }
+
+    // Take the frame returned by the last update() out of the parser along
+    // with the buffer holding it, in O(1) regardless of the payload size.
+    // The parser continues in a buffer from the pool; only the bytes
+    // received after the frame are copied there. The next update() starts
+    // with the next frame. Throws std::runtime_error if no frame is pending
+    // or its payload went to a caller supplied destination.
+    OwnedFrame detach() {
+        if (!done())
+            throw std::runtime_error("detach: no parsed frame");
+        if (m_direct)
+            throw std::runtime_error(
+                "detach: payload is in a caller supplied destination");
+        if (m_retain)
+            throw std::runtime_error("detach: not available in retain mode");
+        FrameBuffer buffer = pool().acquire();
+        std::size_t leftover = remaining();
+        if (leftover > 0) {
+            buffer.ensure_fit(leftover);
+            std::memcpy(buffer.get_space(leftover),
+                        m_frame_buffer.head() + m_ptr, leftover);
+        }
+        drop_times(m_ptr);
+        m_frame_buffer.swap(buffer);
+        m_ptr = 0;
+        m_buffer_holds = false;
+        Frame frame = m_frame;
+        next_frame();
+        return OwnedFrame(frame, std::move(buffer), m_pool);
+    }
+
+    // frames rejected by the filter, and their size including headers
+    std::uint64_t skipped_frames() const { return m_skipped_frames; }
+    std::uint64_t skipped_bytes() const { return m_skipped_bytes; }
+
     std::optional<Frame> update(const FrameBuffer::View& view) {
-        if (done())
-            reset();
-        if (view.size() != 0)
-            m_frame_buffer.push_back(view);
-        else if (m_parse_stage != ParseStage::FIN_BIT)
-            return {};
-        if (remaining() == 0)
-            return {};
-        return parse();
+        return update(std::string_view(
+            reinterpret_cast<const char*>(view.buf()), view.size()));
     }
 
     std::optional<Frame> update(std::string_view view) {
         if (done())
             reset();
         if (view.size() != 0)
-            m_frame_buffer.push_back(view);
-        else if (m_parse_stage != ParseStage::FIN_BIT)
-            return {};
-        if (remaining() == 0)
-            return {};
-        return parse();
+            feed(view);
+        return resume(view.size() != 0);
     }
 
     std::optional<Frame> update(bool new_data) {
         if (done())
             reset();
-        if ((!new_data) && (m_parse_stage != ParseStage::FIN_BIT))
-            return {};
-        if (remaining() == 0)
+        return resume_written(new_data);
+    }
+
+    // Timestamped variants: `time` is when this chunk arrived (e.g. a
+    // SO_TIMESTAMPING software timestamp or a TSC read) and is reported as
+    // Frame::first_byte_time/last_byte_time of the frames it contributes to.
+    // Use them for every chunk of a connection, or not at all.
+    std::optional<Frame> update(const FrameBuffer::View& view,
+                                std::uint64_t time) {
+        return update(std::string_view(reinterpret_cast<const char*>(
+                                           view.buf()),
+                                       view.size()),
+                      time);
+    }
+
+    std::optional<Frame> update(std::string_view view, std::uint64_t time) {
+        if (done())
+            reset();
+        if (view.size() != 0) {
+            m_feed_time = time;
+            feed(view);
+            record_time(time);
+        }
+        return resume(view.size() != 0);
+    }
+
+    // after writing `new_data` directly into frame_buffer()
+    std::optional<Frame> update(bool new_data, std::uint64_t time) {
+        if (done())
+            reset();
+        if (new_data)
+            record_time(time);
+        return resume_written(new_data);
+    }
+
+    // Feed `data` (may be empty) and parse up to `max` frames, writing a
+    // FrameDescriptor for each to `out` instead of returning Frames one by
+    // one; returns the number written. Further complete frames stay
+    // buffered for the next call. Descriptors are relative to
+    // frame_buffer() and valid until the next update or parse_batch call
+    // (in retain mode, until release or the buffer is set aside). Not
+    // available with a payload destination. A frame whose payload ends
+    // beyond 4 GB in the buffer cannot be described: the call that reaches
+    // it returns the frames before it, and the next call throws
+    // std::runtime_error and drops it.
+    std::size_t parse_batch(std::string_view data, FrameDescriptor* out,
+                            std::size_t max) {
+        start_batch();
+        bool new_data = !data.empty();
+        if (new_data)
+            feed(data);
+        return batch(new_data, out, max, nullptr);
+    }
+
+    // Timestamped variant: `data` arrived at `time`, as for the timestamped
+    // update(). If `times` is given, times[i] receives the receive times of
+    // the frame described by out[i].
+    std::size_t parse_batch(std::string_view data, std::uint64_t time,
+                            FrameDescriptor* out, std::size_t max,
+                            FrameTimes* times = nullptr) {
+        start_batch();
+        bool new_data = !data.empty();
+        if (new_data) {
+            m_feed_time = time;
+            feed(data);
+            record_time(time);
+        }
+        return batch(new_data, out, max, times);
+    }
+
+    std::string_view payload(const FrameDescriptor& frame) const {
+        return std::string_view(reinterpret_cast<const char*>(
+                                    m_frame_buffer.head() + frame.offset),
+                                frame.length);
+    }
+
+    std::array<std::uint8_t, 4>
+    masking_key(const FrameDescriptor& frame) const {
+        std::array<std::uint8_t, 4> key{};
+        if (frame.mask())
+            std::memcpy(key.data(), m_frame_buffer.head() + frame.offset - 4,
+                        4);
+        return key;
+    }
+
+    // the described frame as returned by update()
+    Frame frame(const FrameDescriptor& frame) const {
+        Frame out{};
+        out.fin = frame.fin();
+        out.mask = frame.mask();
+        out.opcode = frame.opcode();
+        out.rsv = frame.rsv();
+        out.masking_key = masking_key(frame);
+        out.payload = payload(frame);
+        return out;
+    }
+
+    // Header of the frame being received, available as soon as it is
+    // decoded (payload length and masking key known) and until the next
+    // frame begins; e.g. to size a destination or route the frame before
+    // its payload arrives. Hooks::on_frame_header is the push variant.
+    std::optional<FrameHeader> peek_header() const {
+        if (m_parse_stage < ParseStage::PAYLOAD_DATA)
             return {};
-        return parse();
+        return header();
     }
 
     wsframe::FrameBuffer& frame_buffer() { return m_frame_buffer; }
 };
 
+using FrameParser = BasicFrameParser<>;
+
 } // namespace wsframe
 
 #endif // _WSFRAME_WSFRAME_HPP_
\ No newline at end of file
@@ -0,0 +1,94 @@
+// Two lines racing through the same keys on two threads: each key is won
+// exactly once, and the later copies see the winner's arrival time, so the
+// lag and lead totals are filled in and never taken from an evicted key.
+// Lags stay exact for clocks with large values, such as realtime
+// nanoseconds.
+
+#include <wsframe/arbiter.hpp>
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+#include "check.hpp"
+
+namespace {
+
+constexpr std::uint64_t KEYS = 1 << 20;
+// far fewer keys than the table holds, so the later copy of a key arrives
+// while the key is still in it, and far more than it holds, so ways are
+// reused throughout
+constexpr std::uint64_t WINDOW = 64;
+constexpr std::size_t CAPACITY = 1 << 12;
+
+void contended() {
+    wsframe::FeedArbiter<> arbiter(2, CAPACITY);
+    std::array<std::atomic<std::uint64_t>, 2> progress{};
+
+    auto run = [&](std::size_t line) {
+        for (std::uint64_t i = 0; i < KEYS; i++) {
+            while (i > progress[1 - line].load(std::memory_order_acquire) +
+                           WINDOW) {
+                std::this_thread::yield();
+            }
+            // line 1's copy of key i arrives one tick after line 0's
+            arbiter.offer_key(line, i + 1, 2 * i + 1 + line);
+            progress[line].store(i + 1, std::memory_order_release);
+        }
+    };
+    std::thread other(run, 1);
+    run(0);
+    other.join();
+
+    auto a = arbiter.stats(0);
+    auto b = arbiter.stats(1);
+    CHECK((a.frames == KEYS) && (b.frames == KEYS));
+    CHECK(a.wins + b.wins == KEYS);
+    CHECK(a.wins == b.losses);
+    CHECK(b.wins == a.losses);
+    // both lines won keys, and line 1 is one tick behind whenever it lost
+    CHECK((a.wins > 0) && (b.wins > 0));
+    CHECK(b.lag_total > 0);
+    CHECK(b.lag_max == 1);
+    CHECK(a.lead_total == b.lag_total);
+    // line 0 is never behind
+    CHECK(a.lag_total == 0);
+    CHECK(b.lead_total == 0);
+}
+
+// lag of a copy arriving at `second` behind one arriving at `first`, and
+// the lead credited to the first line
+void lag_between(std::uint64_t first, std::uint64_t second,
+                 std::uint64_t lag) {
+    wsframe::FeedArbiter<> arbiter(2);
+    CHECK(arbiter.offer_key(0, 42, first));
+    CHECK(!arbiter.offer_key(1, 42, second));
+    CHECK(arbiter.stats(1).lag_total == lag);
+    CHECK(arbiter.stats(1).lag_max == lag);
+    CHECK(arbiter.stats(0).lead_total == lag);
+}
+
+void large_times() {
+    // realtime nanoseconds, around 2025
+    const std::uint64_t now = 1760000000000000000ULL;
+    lag_between(now, now + 1000, 1000);
+    lag_between(now + 1000, now, 0);
+    lag_between(now, now, 0);
+    // across a multiple of 2^52
+    const std::uint64_t wrap = std::uint64_t(1) << 52;
+    lag_between(3 * wrap - 10, 3 * wrap + 990, 1000);
+    lag_between(3 * wrap + 990, 3 * wrap - 10, 0);
+    lag_between(UINT64_MAX - 499, 500, 1000);
+    // a TSC far into a long uptime
+    const std::uint64_t tsc = wrap * 5 + 123;
+    lag_between(tsc, tsc + 3000000000ULL, 3000000000ULL);
+}
+
+} // namespace
+
+int main() {
+    contended();
+    large_times();
+    return 0;
+}
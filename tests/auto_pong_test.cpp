@@ -0,0 +1,144 @@
+// In auto pong mode, FrameParser must answer every PING it may answer with
+// a PONG echoing its payload in pending_output(), masked as configured, and
+// return only the other frames, for any chunking, through update() and
+// parse_batch() alike.
+
+#include <wsframe/wsframe.hpp>
+
+#include <algorithm>
+#include <array>
+#include <string>
+#include <vector>
+
+#include "check.hpp"
+
+namespace {
+
+using Opcode = wsframe::Frame::Opcode;
+
+struct Expected {
+    Opcode opcode;
+    std::string payload;
+};
+
+std::string unmasked(const wsframe::Frame& frame) {
+    std::string payload(frame.payload);
+    if (frame.mask) {
+        wsframe::apply_mask(reinterpret_cast<std::uint8_t*>(payload.data()),
+                            reinterpret_cast<const std::uint8_t*>(
+                                payload.data()),
+                            payload.size(), frame.masking_key);
+    }
+    return payload;
+}
+
+void run(std::uint64_t seed, std::size_t max_chunk, bool mask, bool batch) {
+    wsframe::XorShift128Plus rng(seed, ~seed);
+    wsframe::FrameFactory factory;
+    std::string stream;
+    std::vector<Expected> returned;
+    std::vector<std::string> pings;
+    for (int i = 0; i < 3000; i++) {
+        std::uint64_t pick = rng.next64();
+        std::string payload(pick % 126, static_cast<char>('a' + i % 26));
+        bool masked = (pick >> 8) & 1;
+        switch ((pick >> 9) % 8) {
+        case 0:
+        case 1:
+            stream.append(factory.ping(masked, payload));
+            pings.push_back(payload);
+            break;
+        case 2:
+            // pings that may not be answered are returned
+            payload.resize(200, 'o');
+            stream.append(factory.construct(true, Opcode::PING, masked,
+                                             payload));
+            returned.push_back({Opcode::PING, payload});
+            break;
+        case 3:
+            stream.append(factory.construct(false, Opcode::PING, masked,
+                                             payload));
+            returned.push_back({Opcode::PING, payload});
+            break;
+        default:
+            stream.append(factory.binary(true, masked, payload));
+            returned.push_back({Opcode::BINARY, payload});
+        }
+    }
+
+    wsframe::FrameParser parser;
+    parser.set_auto_pong(true, mask);
+    std::size_t n = 0;
+    auto check = [&](const wsframe::Frame& frame) {
+        CHECK(n < returned.size());
+        CHECK(frame.opcode == returned[n].opcode);
+        CHECK(unmasked(frame) == returned[n].payload);
+        n++;
+    };
+    // the output is sent in random pieces and parsed as the peer would
+    wsframe::FrameParser peer;
+    std::size_t pongs = 0;
+    auto send = [&] {
+        std::string_view output = parser.pending_output();
+        std::size_t size = std::min<std::size_t>(
+            output.size(), rng.next64() % (max_chunk + 1));
+        auto pong = peer.update(output.substr(0, size));
+        parser.consume_output(size);
+        while (pong) {
+            CHECK(pong->opcode == Opcode::PONG);
+            CHECK(pong->mask == mask);
+            CHECK(pongs < pings.size());
+            CHECK(unmasked(*pong) == pings[pongs]);
+            pongs++;
+            pong = peer.update(false);
+        }
+    };
+
+    std::array<wsframe::FrameDescriptor, 4> out;
+    for (std::size_t at = 0; at < stream.size();) {
+        std::size_t size = std::min<std::size_t>(
+            stream.size() - at, 1 + rng.next64() % max_chunk);
+        std::string_view chunk = std::string_view(stream).substr(at, size);
+        at += size;
+        if (batch) {
+            std::size_t count = parser.parse_batch(chunk, out.data(), 4);
+            while (count > 0) {
+                for (std::size_t i = 0; i < count; i++)
+                    check(parser.frame(out[i]));
+                count = parser.parse_batch({}, out.data(), 4);
+            }
+        } else {
+            auto frame = parser.update(chunk);
+            while (frame) {
+                check(*frame);
+                frame = parser.update(false);
+            }
+        }
+        send();
+    }
+    while (!parser.pending_output().empty())
+        send();
+    CHECK(n == returned.size());
+    CHECK(pongs == pings.size());
+
+    // pending output survives disabling the mode, later pings are returned
+    parser.update(factory.ping(false, "last"));
+    parser.set_auto_pong(false);
+    CHECK(!parser.pending_output().empty());
+    auto frame = parser.update(factory.ping(false, "returned"));
+    CHECK(frame && frame->opcode == Opcode::PING);
+    parser.consume_output(parser.pending_output().size());
+    CHECK(parser.pending_output().empty());
+}
+
+} // namespace
+
+int main() {
+    for (bool batch : {false, true}) {
+        run(1, 1, false, batch);
+        run(2, 7, true, batch);
+        run(3, 1460, false, batch);
+        run(4, 1 << 16, true, batch);
+    }
+    return 0;
+}
@@ -0,0 +1,95 @@
+// CaptureReader::seek/partition must cover every frame of a time window,
+// including frames stamped exactly begin_time that precede the first index
+// entry with that timestamp.
+
+#include <wsframe/capture.hpp>
+
+#include <set>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include "check.hpp"
+
+namespace {
+
+// chunk c holds 3 frames with payloads "c:0" .. "c:2"
+const std::vector<std::uint64_t> chunk_times = {10, 20, 20, 20, 30, 40};
+
+std::set<std::string> expected(std::uint64_t begin, std::uint64_t end) {
+    std::set<std::string> out;
+    for (std::size_t c = 0; c < chunk_times.size(); c++) {
+        if ((chunk_times[c] < begin) || (chunk_times[c] > end))
+            continue;
+        for (int i = 0; i < 3; i++) {
+            out.insert(std::to_string(c) + ":" + std::to_string(i));
+        }
+    }
+    return out;
+}
+
+// payloads of frames in `ranges` whose chunk lies in [begin, end]
+std::multiset<std::string>
+replayed(const wsframe::CaptureReader& reader,
+         const std::vector<wsframe::CaptureReader::Range>& ranges,
+         std::uint64_t begin, std::uint64_t end) {
+    std::multiset<std::string> out;
+    wsframe::FrameParser parser;
+    for (const auto& range : ranges) {
+        reader.replay(range, parser, [&](const wsframe::Frame& frame) {
+            std::string payload(frame.payload);
+            std::uint64_t time = chunk_times[std::stoul(payload)];
+            if ((time >= begin) && (time <= end))
+                out.insert(payload);
+        });
+    }
+    return out;
+}
+
+void check_window(const wsframe::CaptureReader& reader, std::uint64_t begin,
+                  std::uint64_t end) {
+    auto want = expected(begin, end);
+    auto got = replayed(reader, {reader.seek(begin, end)}, begin, end);
+    CHECK(std::set<std::string>(got.begin(), got.end()) == want);
+    CHECK(got.size() == want.size());
+    for (std::size_t parts = 1; parts <= 4; parts++) {
+        got = replayed(reader, reader.partition(parts, begin, end), begin,
+                       end);
+        CHECK(std::set<std::string>(got.begin(), got.end()) == want);
+        // ranges do not overlap
+        CHECK(got.size() == want.size());
+    }
+}
+
+} // namespace
+
+int main() {
+    std::string prefix =
+        "/tmp/wsframe_capture_test_" + std::to_string(::getpid());
+    // frames are 5 bytes, chunks 15; index intervals that land entries in
+    // the middle of chunks as well as on their boundaries
+    for (std::uint64_t interval = 1; interval <= 40; interval++) {
+        {
+            wsframe::FrameFactory factory;
+            wsframe::CaptureWriter writer(prefix, interval);
+            for (std::size_t c = 0; c < chunk_times.size(); c++) {
+                std::string chunk;
+                for (int i = 0; i < 3; i++) {
+                    chunk += factory.binary(
+                        true, false,
+                        std::to_string(c) + ":" + std::to_string(i));
+                }
+                writer.write(chunk, chunk_times[c]);
+            }
+        }
+        wsframe::CaptureReader reader(prefix);
+        check_window(reader, 20, 20);
+        check_window(reader, 20, 30);
+        check_window(reader, 15, 25);
+        check_window(reader, 0, 100);
+        check_window(reader, 40, 40);
+    }
+    std::remove(wsframe::Capture::data_path(prefix).c_str());
+    std::remove(wsframe::Capture::index_path(prefix).c_str());
+    return 0;
+}
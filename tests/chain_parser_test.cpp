@@ -0,0 +1,93 @@
+// ChainParser must return every frame of a stream cut into chains of
+// separately allocated slabs, for any slab and chain sizes, with headers
+// and payloads straddling slabs and chains, in both payload modes and
+// through the iovec overload.
+
+#include <wsframe/chain_parser.hpp>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "check.hpp"
+
+namespace {
+
+using wsframe::ChainParser;
+
+void run(std::uint64_t seed, std::size_t max_slab,
+         ChainParser::PayloadMode mode, bool iovec) {
+    wsframe::XorShift128Plus rng(seed, ~seed);
+    wsframe::FrameFactory factory;
+    std::string stream;
+    std::vector<std::string> payloads;
+    for (int i = 0; i < 2000; i++) {
+        std::uint64_t pick = rng.next64();
+        std::size_t size = (i % 100 == 0) ? 70000 : pick % 300;
+        std::string payload(size, 0);
+        for (char& c : payload)
+            c = static_cast<char>(rng.next64());
+        stream.append(factory.binary(true, pick & 1, payload));
+        payloads.push_back(std::move(payload));
+    }
+
+    ChainParser parser(mode);
+    std::size_t n = 0;
+    std::string copy;
+    auto on_frame = [&](const ChainParser::ChainFrame& frame) {
+        CHECK(n < payloads.size());
+        const std::string& expected = payloads[n++];
+        CHECK(frame.frame.opcode == wsframe::Frame::Opcode::BINARY);
+        CHECK(frame.header.payload_len == expected.size());
+        if (mode == ChainParser::PayloadMode::COALESCE)
+            CHECK(frame.contiguous());
+        std::size_t total = 0;
+        for (auto fragment : frame.fragments)
+            total += fragment.size();
+        CHECK(total == expected.size());
+        if (frame.contiguous())
+            CHECK(frame.frame.payload.size() == expected.size());
+        copy.assign(expected.size(), 0);
+        frame.copy_payload(reinterpret_cast<std::uint8_t*>(copy.data()), true);
+        CHECK(copy == expected);
+    };
+
+    std::vector<std::string> slabs;
+    std::vector<std::string_view> chain;
+    std::vector<struct iovec> iov;
+    for (std::size_t at = 0; at < stream.size();) {
+        slabs.clear();
+        std::size_t count = 1 + rng.next64() % 8;
+        for (std::size_t i = 0; i < count && at < stream.size(); i++) {
+            // empty slabs included
+            std::size_t size = std::min<std::size_t>(
+                stream.size() - at, rng.next64() % (max_slab + 1));
+            slabs.push_back(stream.substr(at, size));
+            at += size;
+        }
+        chain.assign(slabs.begin(), slabs.end());
+        if (iovec) {
+            iov.clear();
+            for (std::string& slab : slabs)
+                iov.push_back({slab.data(), slab.size()});
+            parser.update(iov.data(), iov.size(), on_frame);
+        } else {
+            parser.update(chain, on_frame);
+        }
+    }
+    CHECK(n == payloads.size());
+    CHECK(parser.carried() == 0);
+}
+
+} // namespace
+
+int main() {
+    for (auto mode : {ChainParser::PayloadMode::FRAGMENTS,
+                      ChainParser::PayloadMode::COALESCE}) {
+        run(1, 1, mode, false);
+        run(2, 13, mode, false);
+        run(3, 1460, mode, true);
+        run(4, 1 << 16, mode, false);
+    }
+    return 0;
+}
@@ -0,0 +1,19 @@
+#ifndef _WSFRAME_TESTS_CHECK_HPP_
+#define _WSFRAME_TESTS_CHECK_HPP_
+
+// Minimal assertion for the test programs; unlike assert() it stays active
+// in Release builds.
+
+#include <cstdio>
+#include <cstdlib>
+
+#define CHECK(cond)                                                            \
+    do {                                                                       \
+        if (!(cond)) {                                                         \
+            std::fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__,        \
+                         __LINE__, #cond);                                     \
+            std::exit(1);                                                      \
+        }                                                                      \
+    } while (0)
+
+#endif // _WSFRAME_TESTS_CHECK_HPP_
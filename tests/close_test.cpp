@@ -0,0 +1,110 @@
+// CLOSE frames encoded by FrameFactory::close(mask, code, reason) must
+// decode, masked or not, to the same code and reason with
+// CloseStatus::decode(), which must reject the payloads RFC 6455 calls
+// protocol errors; the encoder must refuse what may not be sent.
+
+#include <wsframe/wsframe.hpp>
+
+#include <stdexcept>
+#include <string>
+
+#include "check.hpp"
+
+namespace {
+
+using wsframe::CloseCode;
+using wsframe::CloseStatus;
+
+template <typename F> bool throws(F f) {
+    try {
+        f();
+    } catch (const std::runtime_error&) {
+        return true;
+    }
+    return false;
+}
+
+void round_trip() {
+    wsframe::FrameFactory factory;
+    wsframe::FrameParser parser;
+    std::string reason;
+    for (std::uint32_t code = 0; code < 6000; code++) {
+        bool valid = CloseStatus::valid(static_cast<std::uint16_t>(code));
+        CHECK(valid == (((code >= 1000) && (code <= 1003)) ||
+                        ((code >= 1007) && (code <= 1014)) ||
+                        ((code >= 3000) && (code <= 4999))));
+        bool mask = code & 1;
+        reason.assign(code % (CloseStatus::MAX_REASON + 1),
+                      static_cast<char>('a' + code % 26));
+        if (!valid) {
+            CHECK(throws([&] {
+                factory.close(mask, static_cast<std::uint16_t>(code), reason);
+            }));
+            continue;
+        }
+        auto frame = parser.update(
+            factory.close(mask, static_cast<std::uint16_t>(code), reason));
+        CHECK(frame.has_value());
+        CHECK(frame->opcode == wsframe::Frame::Opcode::CLOSE);
+        CHECK(frame->fin);
+        CHECK(frame->mask == mask);
+        CloseStatus status = CloseStatus::decode(*frame);
+        CHECK(status.code() == code);
+        CHECK(status.reason() == reason);
+        // unmasked reasons are views into the payload
+        if (!mask && !reason.empty())
+            CHECK(status.reason().data() == frame->payload.data() + 2);
+    }
+
+    auto frame = parser.update(factory.close(true, CloseCode::GOING_AWAY));
+    CHECK(frame.has_value());
+    CHECK(CloseStatus::decode(*frame).code() ==
+          static_cast<std::uint16_t>(CloseCode::GOING_AWAY));
+    CHECK(CloseStatus::decode(*frame).reason().empty());
+
+    std::string too_long(CloseStatus::MAX_REASON + 1, 'x');
+    CHECK(throws([&] { factory.close(false, CloseCode::NORMAL, too_long); }));
+    CHECK(!throws([&] {
+        factory.close(false, CloseCode::NORMAL, too_long.substr(1));
+    }));
+}
+
+void invalid_payloads() {
+    wsframe::FrameFactory factory;
+    wsframe::FrameParser parser;
+    auto decode = [&](bool mask, std::string_view payload) {
+        auto frame = parser.update(factory.close(mask, payload));
+        CHECK(frame.has_value());
+        return CloseStatus::decode(*frame);
+    };
+    for (bool mask : {false, true}) {
+        // an empty payload reports NO_STATUS
+        CloseStatus status = decode(mask, {});
+        CHECK(status.code() ==
+              static_cast<std::uint16_t>(CloseCode::NO_STATUS));
+        CHECK(status.reason().empty());
+
+        CHECK(throws([&] { decode(mask, std::string(1, '\x03')); }));
+        // reserved, report-only and out of range codes
+        for (std::uint16_t code : {999, 1004, 1005, 1006, 1015, 2999, 5000}) {
+            std::string payload = {static_cast<char>(code >> 8),
+                                   static_cast<char>(code & 0xFF)};
+            CHECK(throws([&] { decode(mask, payload + "why"); }));
+        }
+        std::string payload = {0x03, static_cast<char>(0xE8)};
+        CHECK(decode(mask, payload + "bye").code() == 1000);
+        CHECK(decode(mask, payload + "bye").reason() == "bye");
+    }
+
+    auto frame = parser.update(factory.text(true, false, "\x03\xE8"));
+    CHECK(frame.has_value());
+    CHECK(throws([&] { CloseStatus::decode(*frame); }));
+}
+
+} // namespace
+
+int main() {
+    round_trip();
+    invalid_payloads();
+    return 0;
+}
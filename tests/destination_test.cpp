@@ -0,0 +1,92 @@
+// Payloads routed by FrameParser::set_payload_destination() must arrive
+// unmasked in the caller's memory for any chunking, without growing the
+// frame buffer, while frames it declines are buffered as usual.
+
+#include <wsframe/wsframe.hpp>
+
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "check.hpp"
+
+namespace {
+
+// frames with at least this many payload bytes go to a destination
+constexpr std::size_t DIRECT_MIN = 100;
+
+void run(std::uint64_t seed, std::size_t max_chunk) {
+    wsframe::XorShift128Plus rng(seed, ~seed);
+    wsframe::FrameFactory factory;
+    std::string stream;
+    std::vector<std::string> payloads;
+    for (int i = 0; i < 1000; i++) {
+        std::uint64_t pick = rng.next64();
+        std::size_t size = (i % 50 == 0) ? (2 << 20) : pick % 300;
+        std::string payload(size, 0);
+        for (char& c : payload)
+            c = static_cast<char>(rng.next64());
+        stream.append(factory.binary(true, pick & 1, payload));
+        payloads.push_back(std::move(payload));
+    }
+
+    wsframe::FrameParser parser;
+    std::unique_ptr<std::uint8_t[]> destination;
+    std::size_t destination_size = 0;
+    parser.set_payload_destination(
+        [&](const wsframe::FrameHeader& header) -> std::uint8_t* {
+            CHECK(header.opcode == wsframe::Frame::Opcode::BINARY);
+            if (header.payload_len < DIRECT_MIN)
+                return nullptr;
+            destination.reset(new std::uint8_t[header.payload_len]);
+            destination_size = header.payload_len;
+            return destination.get();
+        });
+
+    std::size_t n = 0;
+    for (std::size_t at = 0; at < stream.size();) {
+        std::size_t size = std::min<std::size_t>(
+            stream.size() - at, 1 + rng.next64() % max_chunk);
+        auto frame = parser.update(std::string_view(stream).substr(at, size));
+        at += size;
+        while (frame) {
+            CHECK(n < payloads.size());
+            const std::string& expected = payloads[n++];
+            CHECK(frame->payload.size() == expected.size());
+            if (expected.size() >= DIRECT_MIN) {
+                CHECK(!frame->mask);
+                CHECK(destination_size == expected.size());
+                CHECK(reinterpret_cast<const std::uint8_t*>(
+                          frame->payload.data()) == destination.get());
+                CHECK(frame->payload == expected);
+            } else if (!frame->mask) {
+                CHECK(frame->payload == expected);
+            }
+            frame = parser.update(false);
+        }
+        // direct payloads never pass through the frame buffer
+        CHECK(parser.frame_buffer().capacity() < (1 << 20));
+    }
+    CHECK(n == payloads.size());
+
+    bool threw = false;
+    wsframe::FrameDescriptor out[1];
+    try {
+        parser.parse_batch(std::string_view(stream).substr(0, 64), out, 1);
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    CHECK(threw);
+}
+
+} // namespace
+
+int main() {
+    run(1, 1);
+    run(2, 7);
+    run(3, 1460);
+    run(4, 1 << 16);
+    return 0;
+}
@@ -0,0 +1,110 @@
+// Frames taken out of FrameParser with detach() must keep their payload
+// across any number of further updates, the parser must go on with the
+// following frames, and the buffers must return to the shared
+// FrameBufferPool when the OwnedFrames are destroyed, on any thread.
+
+#include <wsframe/wsframe.hpp>
+
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "check.hpp"
+
+namespace {
+
+std::string payload_of(std::size_t n) {
+    return std::string(n * 7 % 500, static_cast<char>('a' + n % 26));
+}
+
+template <typename F> bool throws(F f) {
+    try {
+        f();
+    } catch (const std::runtime_error&) {
+        return true;
+    }
+    return false;
+}
+
+void run(std::uint64_t seed, std::size_t max_chunk) {
+    constexpr std::size_t FRAMES = 3000;
+    wsframe::XorShift128Plus rng(seed, ~seed);
+    wsframe::FrameFactory factory;
+    std::string stream;
+    for (std::size_t n = 0; n < FRAMES; n++) {
+        stream.append(factory.binary(true, false, payload_of(n)));
+    }
+
+    auto pool = std::make_shared<wsframe::FrameBufferPool>(4096, 8);
+    wsframe::FrameParser parser;
+    parser.set_buffer_pool(pool);
+    CHECK(throws([&] { parser.detach(); }));
+
+    // every third frame is detached and kept for a while
+    std::vector<std::pair<std::size_t, wsframe::OwnedFrame>> held;
+    std::size_t n = 0;
+    for (std::size_t at = 0; at < stream.size();) {
+        std::size_t size = std::min<std::size_t>(
+            stream.size() - at, 1 + rng.next64() % max_chunk);
+        auto frame = parser.update(std::string_view(stream).substr(at, size));
+        at += size;
+        while (frame) {
+            CHECK(frame->payload == payload_of(n));
+            if (n % 3 == 0) {
+                wsframe::OwnedFrame owned = parser.detach();
+                CHECK(owned);
+                CHECK(owned.payload() == payload_of(n));
+                CHECK(throws([&] { parser.detach(); }));
+                held.emplace_back(n, std::move(owned));
+            }
+            n++;
+            frame = parser.update(false);
+        }
+        if (held.size() >= 20) {
+            for (auto& [number, owned] : held)
+                CHECK(owned.payload() == payload_of(number));
+            // released on another thread
+            std::thread([&] { held.clear(); }).join();
+            CHECK(pool->idle() == 8);
+        }
+    }
+    CHECK(n == FRAMES);
+    for (auto& [number, owned] : held)
+        CHECK(owned->payload == payload_of(number));
+
+    // a detach takes one buffer from the pool, a moved OwnedFrame gives one
+    // back, once
+    held.clear();
+    std::size_t idle = pool->idle();
+    CHECK(idle > 0);
+    CHECK(parser.update(factory.binary(true, false, "moved")).has_value());
+    {
+        wsframe::OwnedFrame owned = parser.detach();
+        CHECK(pool->idle() == idle - 1);
+        wsframe::OwnedFrame moved = std::move(owned);
+        CHECK(!owned);
+        CHECK(moved.payload() == "moved");
+        wsframe::OwnedFrame assigned;
+        assigned = std::move(moved);
+        CHECK(!moved);
+        CHECK(assigned.payload() == "moved");
+    }
+    CHECK(pool->idle() == idle);
+
+    parser.set_retain(true);
+    parser.update(factory.binary(true, false, "retained"));
+    CHECK(throws([&] { parser.detach(); }));
+}
+
+} // namespace
+
+int main() {
+    run(1, 1);
+    run(2, 7);
+    run(3, 1460);
+    run(4, 1 << 16);
+    return 0;
+}
@@ -0,0 +1,64 @@
+// Bytes written straight into FrameParser::frame_buffer() and announced with
+// update(true) / update(true, time) must be parsed like fed chunks, and the
+// buffer must be compacted rather than grow with the stream.
+
+#include <wsframe/wsframe.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+#include "check.hpp"
+
+namespace {
+
+constexpr std::size_t FRAMES = 100000;
+// 22 byte frames delivered in chunks of 22 bytes, one byte behind, so the
+// buffer always ends in the middle of a frame and is never emptied
+constexpr std::size_t CHUNK = 22;
+
+std::string payload_of(std::size_t n) {
+    std::string out = std::to_string(n);
+    out.resize(20, '.');
+    return out;
+}
+
+void run(bool timed) {
+    std::string stream;
+    wsframe::FrameFactory factory;
+    for (std::size_t n = 0; n < FRAMES; n++) {
+        stream.append(factory.binary(true, false, payload_of(n)));
+    }
+    CHECK(stream.size() == FRAMES * 22);
+
+    wsframe::FrameParser parser;
+    std::size_t initial_capacity = parser.frame_buffer().capacity();
+    std::size_t frames = 0;
+    for (std::size_t at = 0; at < stream.size();) {
+        std::size_t size = std::min(at == 0 ? 1 : CHUNK, stream.size() - at);
+        std::uint64_t time = at / CHUNK + 1;
+        wsframe::FrameBuffer& buffer = parser.frame_buffer();
+        buffer.ensure_extra_space(size);
+        std::memcpy(buffer.get_space(size), stream.data() + at, size);
+        at += size;
+
+        auto frame = timed ? parser.update(true, time) : parser.update(true);
+        while (frame) {
+            CHECK(frame->payload == payload_of(frames));
+            if (timed)
+                CHECK(frame->last_byte_time == time);
+            frames++;
+            frame = timed ? parser.update(false, time) : parser.update(false);
+        }
+        CHECK(parser.frame_buffer().capacity() <= initial_capacity);
+    }
+    CHECK(frames == FRAMES);
+}
+
+} // namespace
+
+int main() {
+    run(false);
+    run(true);
+    return 0;
+}
@@ -0,0 +1,94 @@
+// Frames rejected by FrameParser::set_filter() must be skipped without being
+// buffered and counted in skipped_frames()/skipped_bytes(), while the frames
+// around them are returned intact for any chunking.
+
+#include <wsframe/wsframe.hpp>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "check.hpp"
+
+namespace {
+
+struct Expected {
+    bool kept;
+    std::string payload;
+};
+
+std::string unmasked(const wsframe::Frame& frame) {
+    std::string payload(frame.payload);
+    if (frame.mask) {
+        wsframe::apply_mask(reinterpret_cast<std::uint8_t*>(payload.data()),
+                            reinterpret_cast<const std::uint8_t*>(
+                                payload.data()),
+                            payload.size(), frame.masking_key);
+    }
+    return payload;
+}
+
+void run(std::uint64_t seed, std::size_t max_chunk) {
+    wsframe::XorShift128Plus rng(seed, ~seed);
+    wsframe::FrameFactory factory;
+    std::string stream;
+    std::vector<Expected> frames;
+    std::uint64_t skipped_bytes = 0;
+    // TEXT frames are filtered out; some are 2 MB
+    for (int i = 0; i < 1000; i++) {
+        std::uint64_t pick = rng.next64();
+        bool kept = pick & 1;
+        std::size_t size = (!kept && i % 50 == 0) ? (2 << 20) : pick % 300;
+        std::string payload(size, static_cast<char>('a' + i % 26));
+        std::string_view raw =
+            kept ? factory.binary(true, (pick >> 1) & 1, payload)
+                 : factory.text(true, (pick >> 1) & 1, payload);
+        stream.append(raw);
+        if (!kept)
+            skipped_bytes += raw.size();
+        frames.push_back({kept, std::move(payload)});
+    }
+
+    wsframe::FrameParser parser;
+    parser.set_filter([](const wsframe::FrameHeader& header) {
+        return header.opcode != wsframe::Frame::Opcode::TEXT;
+    });
+    std::size_t n = 0;
+    auto next_kept = [&] {
+        while (n < frames.size() && !frames[n].kept)
+            n++;
+        CHECK(n < frames.size());
+        return frames[n++].payload;
+    };
+    for (std::size_t at = 0; at < stream.size();) {
+        std::size_t size = std::min<std::size_t>(
+            stream.size() - at, 1 + rng.next64() % max_chunk);
+        auto frame = parser.update(std::string_view(stream).substr(at, size));
+        at += size;
+        while (frame) {
+            CHECK(frame->opcode == wsframe::Frame::Opcode::BINARY);
+            CHECK(unmasked(*frame) == next_kept());
+            frame = parser.update(false);
+        }
+        // skipped payloads are dropped as they arrive
+        CHECK(parser.frame_buffer().capacity() < (1 << 20));
+    }
+    while (n < frames.size() && !frames[n].kept)
+        n++;
+    CHECK(n == frames.size());
+    CHECK(parser.skipped_frames() ==
+          static_cast<std::uint64_t>(
+              std::count_if(frames.begin(), frames.end(),
+                            [](const Expected& e) { return !e.kept; })));
+    CHECK(parser.skipped_bytes() == skipped_bytes);
+}
+
+} // namespace
+
+int main() {
+    run(1, 1);
+    run(2, 7);
+    run(3, 1460);
+    run(4, 1 << 16);
+    return 0;
+}
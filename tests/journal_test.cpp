@@ -0,0 +1,152 @@
+// JournalWriter/JournalReader round trips across many segments, a reader
+// tailing a journal while it is being written, and segments with a header
+// the reader does not support.
+
+#include <wsframe/journal.hpp>
+
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unistd.h>
+
+#include "check.hpp"
+
+namespace {
+
+const std::string prefix =
+    "/tmp/wsframe_journal_test_" + std::to_string(::getpid());
+
+void remove_journal() {
+    for (std::uint64_t i = 0;; i++) {
+        std::string path = wsframe::Journal::segment_path(prefix, i);
+        if (!wsframe::MappedFile::exists(path))
+            break;
+        std::remove(path.c_str());
+    }
+}
+
+std::string payload_of(std::uint64_t n) {
+    return std::string(n % 300, static_cast<char>('a' + n % 26));
+}
+
+// record n as written by write_records
+void check_record(const wsframe::JournalReader::Entry& entry, std::uint64_t n) {
+    CHECK(entry.timestamp == n);
+    CHECK(entry.connection_id == n % 3);
+    CHECK(entry.direction == ((n % 2) ? wsframe::Journal::Direction::OUTBOUND
+                                      : wsframe::Journal::Direction::INBOUND));
+    wsframe::Frame frame = entry.frame();
+    CHECK(frame.opcode == wsframe::Frame::Opcode::BINARY);
+    CHECK(frame.mask == (n % 4 == 0));
+    std::string payload(frame.payload);
+    if (frame.mask) {
+        wsframe::apply_mask(reinterpret_cast<std::uint8_t*>(payload.data()),
+                            reinterpret_cast<const std::uint8_t*>(
+                                payload.data()),
+                            payload.size(), frame.masking_key);
+    }
+    CHECK(payload == payload_of(n));
+    CHECK(entry.wire_size() ==
+          entry.header.size() + payload_of(n).size());
+}
+
+// masked frames through write_raw, the others parsed and passed as Frames
+void write_records(wsframe::JournalWriter& writer, std::uint64_t count) {
+    wsframe::FrameFactory factory;
+    wsframe::FrameParser parser;
+    for (std::uint64_t n = 0; n < count; n++) {
+        auto direction = (n % 2) ? wsframe::Journal::Direction::OUTBOUND
+                                 : wsframe::Journal::Direction::INBOUND;
+        std::string_view raw = factory.binary(true, n % 4 == 0, payload_of(n));
+        if (n % 4 == 0) {
+            writer.write_raw(raw, direction, n % 3, n);
+            continue;
+        }
+        auto frame = parser.update(raw);
+        CHECK(frame.has_value());
+        writer.write(*frame, direction, n % 3, n);
+    }
+}
+
+void round_trip() {
+    const std::uint64_t count = 5000;
+    {
+        wsframe::JournalWriter writer(prefix, 4096, false);
+        write_records(writer, count);
+        CHECK(writer.segments() > 100);
+    }
+    wsframe::JournalReader reader(prefix);
+    for (std::uint64_t n = 0; n < count; n++) {
+        auto entry = reader.next();
+        CHECK(entry.has_value());
+        check_record(*entry, n);
+    }
+    CHECK(!reader.next().has_value());
+    remove_journal();
+}
+
+void live_tail() {
+    const std::uint64_t count = 50000;
+    wsframe::JournalWriter writer(prefix, 8192, false);
+    std::thread producer([&] { write_records(writer, count); });
+    wsframe::JournalReader reader(prefix);
+    for (std::uint64_t n = 0; n < count;) {
+        auto entry = reader.next();
+        if (!entry) {
+            std::this_thread::yield();
+            continue;
+        }
+        check_record(*entry, n);
+        n++;
+    }
+    producer.join();
+    CHECK(!reader.next().has_value());
+    remove_journal();
+}
+
+void unsupported_header() {
+    {
+        wsframe::JournalWriter writer(prefix, 4096, false);
+        write_records(writer, 10);
+    }
+    // version, then header_size
+    std::string path = wsframe::Journal::segment_path(prefix, 0);
+    for (long offset : {8L, 12L}) {
+        std::FILE* file = std::fopen(path.c_str(), "r+b");
+        CHECK(file != nullptr);
+        std::uint32_t saved;
+        std::fseek(file, offset, SEEK_SET);
+        CHECK(std::fread(&saved, sizeof(saved), 1, file) == 1);
+        std::uint32_t bad = saved + 1;
+        std::fseek(file, offset, SEEK_SET);
+        std::fwrite(&bad, sizeof(bad), 1, file);
+        std::fclose(file);
+
+        bool threw = false;
+        try {
+            wsframe::JournalReader reader(prefix);
+        } catch (const std::runtime_error&) {
+            threw = true;
+        }
+        CHECK(threw);
+
+        file = std::fopen(path.c_str(), "r+b");
+        std::fseek(file, offset, SEEK_SET);
+        std::fwrite(&saved, sizeof(saved), 1, file);
+        std::fclose(file);
+    }
+    wsframe::JournalReader reader(prefix);
+    CHECK(reader.next().has_value());
+    remove_journal();
+}
+
+} // namespace
+
+int main() {
+    remove_journal();
+    round_trip();
+    live_tail();
+    unsupported_header();
+    return 0;
+}
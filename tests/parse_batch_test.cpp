@@ -0,0 +1,114 @@
+// FrameParser::parse_batch() must describe every frame of a stream, for any
+// chunking and any batch size: header fields, masking key and payload of
+// each descriptor as update() would return them, with complete frames
+// beyond `max` left buffered for the next call.
+
+#include <wsframe/wsframe.hpp>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "check.hpp"
+
+namespace {
+
+struct Expected {
+    bool fin;
+    bool mask;
+    wsframe::Frame::Opcode opcode;
+    std::uint8_t rsv;
+    std::size_t header_len;
+    std::string payload;
+};
+
+std::string unmasked(const wsframe::Frame& frame) {
+    std::string payload(frame.payload);
+    if (frame.mask) {
+        wsframe::apply_mask(reinterpret_cast<std::uint8_t*>(payload.data()),
+                            reinterpret_cast<const std::uint8_t*>(
+                                payload.data()),
+                            payload.size(), frame.masking_key);
+    }
+    return payload;
+}
+
+void run(std::uint64_t seed, std::size_t max_chunk, std::size_t max) {
+    using Opcode = wsframe::Frame::Opcode;
+    const Opcode opcodes[] = {Opcode::TEXT, Opcode::BINARY,
+                              Opcode::CONTINUATION, Opcode::PING};
+    wsframe::XorShift128Plus rng(seed, ~seed);
+    wsframe::FrameFactory factory;
+    std::string stream;
+    std::vector<Expected> frames;
+    for (int i = 0; i < 3000; i++) {
+        std::uint64_t pick = rng.next64();
+        // 7, 16 and 64 bit lengths
+        std::size_t size = (i % 100 == 0)  ? 70000 + pick % 1000
+                           : (i % 10 == 0) ? 126 + pick % 1000
+                                           : pick % 126;
+        std::string payload(size, 0);
+        for (char& c : payload)
+            c = static_cast<char>(rng.next64());
+        Opcode opcode = opcodes[(pick >> 8) % 4];
+        if (opcode == Opcode::PING)
+            payload.resize(std::min<std::size_t>(size, 125));
+        bool fin = (opcode == Opcode::PING) || ((pick >> 12) & 1);
+        bool mask = (pick >> 13) & 1;
+        std::uint8_t rsv = ((pick >> 14) & 1) ? 0x40 : 0;
+        std::string_view raw =
+            factory.construct(fin, opcode, mask, payload, rsv);
+        stream.append(raw);
+        frames.push_back({fin, mask, opcode, rsv, raw.size() - payload.size(),
+                          std::move(payload)});
+    }
+
+    wsframe::FrameParser parser;
+    std::vector<wsframe::FrameDescriptor> out(max);
+    std::size_t n = 0;
+    auto check = [&](std::size_t count) {
+        CHECK(count <= max);
+        for (std::size_t i = 0; i < count; i++) {
+            CHECK(n < frames.size());
+            const Expected& expected = frames[n++];
+            const wsframe::FrameDescriptor& desc = out[i];
+            CHECK(desc.fin() == expected.fin);
+            CHECK(desc.mask() == expected.mask);
+            CHECK(desc.opcode() == expected.opcode);
+            CHECK(desc.rsv() == expected.rsv);
+            CHECK(desc.header_len == expected.header_len);
+            CHECK(desc.length == expected.payload.size());
+            wsframe::Frame frame = parser.frame(desc);
+            CHECK(frame.payload.data() == parser.payload(desc).data());
+            CHECK(frame.masking_key == parser.masking_key(desc));
+            CHECK(unmasked(frame) == expected.payload);
+        }
+    };
+    for (std::size_t at = 0; at < stream.size();) {
+        std::size_t size = std::min<std::size_t>(
+            stream.size() - at, 1 + rng.next64() % max_chunk);
+        std::size_t count = parser.parse_batch(
+            std::string_view(stream).substr(at, size), out.data(), max);
+        at += size;
+        // a full batch may leave complete frames buffered
+        while (count > 0) {
+            check(count);
+            if (count < max)
+                break;
+            count = parser.parse_batch({}, out.data(), max);
+        }
+    }
+    CHECK(parser.parse_batch({}, out.data(), max) == 0);
+    CHECK(n == frames.size());
+}
+
+} // namespace
+
+int main() {
+    run(1, 1, 1);
+    run(2, 7, 3);
+    run(3, 1460, 4);
+    run(4, 1 << 16, 16);
+    run(5, 1 << 20, 64);
+    return 0;
+}
@@ -0,0 +1,93 @@
+// In retain mode, payloads returned by FrameParser must stay valid across
+// further updates until released, for any chunking, and set-aside buffers
+// must go back to the pool once all of their frames are released.
+
+#include <wsframe/wsframe.hpp>
+
+#include <algorithm>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "check.hpp"
+
+namespace {
+
+struct Held {
+    std::uint64_t frame;
+    std::string_view payload;
+    std::size_t n;
+};
+
+std::string payload_of(std::size_t n) {
+    return std::string(n * 13 % 1000, static_cast<char>('a' + n % 26));
+}
+
+void run(std::uint64_t seed, std::size_t max_chunk, std::size_t window) {
+    constexpr std::size_t FRAMES = 5000;
+    wsframe::XorShift128Plus rng(seed, ~seed);
+    wsframe::FrameFactory factory;
+    std::string stream;
+    for (std::size_t n = 0; n < FRAMES; n++) {
+        stream.append(factory.binary(true, false, payload_of(n)));
+    }
+
+    auto pool = std::make_shared<wsframe::FrameBufferPool>(4096, 64);
+    wsframe::FrameParser parser;
+    parser.set_buffer_pool(pool);
+    parser.set_retain(true);
+
+    // the last `window` frames are held, older ones released
+    std::deque<Held> held;
+    std::size_t n = 0;
+    std::size_t max_retained = 0;
+    for (std::size_t at = 0; at < stream.size();) {
+        std::size_t size = std::min<std::size_t>(
+            stream.size() - at, 1 + rng.next64() % max_chunk);
+        auto frame = parser.update(std::string_view(stream).substr(at, size));
+        at += size;
+        while (frame) {
+            CHECK(frame->payload == payload_of(n));
+            CHECK(parser.frame_count() == n + 1);
+            held.push_back({parser.frame_count() - 1, frame->payload, n});
+            n++;
+            frame = parser.update(false);
+        }
+        for (const Held& h : held)
+            CHECK(h.payload == payload_of(h.n));
+        if (held.size() > window) {
+            held.erase(held.begin(), held.end() - window);
+            parser.release(held.front().frame - 1);
+        }
+        max_retained = std::max(max_retained, parser.retained_buffers());
+    }
+    CHECK(n == FRAMES);
+    for (const Held& h : held)
+        CHECK(h.payload == payload_of(h.n));
+    CHECK(max_retained > 0);
+
+    // set-aside buffers go back to the pool
+    parser.release_all();
+    CHECK(parser.retained_buffers() == 0);
+    CHECK(pool->idle() > 0);
+    std::size_t idle = pool->idle();
+
+    // leaving retain mode releases everything, the parser goes on as usual
+    parser.update(factory.binary(true, false, payload_of(1)));
+    parser.set_retain(false);
+    CHECK(parser.retained_buffers() == 0);
+    CHECK(pool->idle() >= idle);
+    auto frame = parser.update(factory.binary(true, false, payload_of(2)));
+    CHECK(frame && frame->payload == payload_of(2));
+}
+
+} // namespace
+
+int main() {
+    run(1, 1, 1);
+    run(2, 7, 50);
+    run(3, 1460, 10);
+    run(4, 1 << 16, 200);
+    return 0;
+}
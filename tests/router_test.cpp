@@ -0,0 +1,125 @@
+// PrefixRouter must return the longest registered prefix of a payload, as a
+// linear scan over the prefixes would, for plain and masked payloads, and
+// RouteHooks must route every TEXT/BINARY frame a parser returns.
+
+#include <wsframe/router.hpp>
+
+#include <array>
+#include <set>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "check.hpp"
+
+namespace {
+
+static constexpr std::array<std::string_view, 4> channels = {
+    R"({"channel":"trades")", R"({"channel":"book")",
+    R"({"channel":"book.l2")", R"({"op":)"};
+static constexpr auto channel_router = wsframe::make_prefix_router<channels>();
+
+static_assert(channel_router.route(R"({"channel":"book.l2","x":1})") == 2);
+static_assert(channel_router.route(R"({"channel":"book","depth":5})") == 1);
+static_assert(channel_router.route(R"({"channel":"trade")") ==
+              decltype(channel_router)::NO_ROUTE);
+static_assert(decltype(channel_router)::max_prefix == 20);
+
+constexpr std::size_t N = 40;
+constexpr std::size_t MAX_LEN = 8;
+
+std::string random_string(wsframe::XorShift128Plus& rng, std::size_t max_len) {
+    std::string out(rng.next64() % (max_len + 1), 0);
+    // a small alphabet, so prefixes share and nest
+    for (char& c : out)
+        c = "abc\xff"[rng.next64() % 4];
+    return out;
+}
+
+int longest_prefix(const std::array<std::string, N>& prefixes,
+                   std::string_view payload) {
+    int best = -1;
+    for (std::size_t i = 0; i < N; i++) {
+        if ((payload.substr(0, prefixes[i].size()) == prefixes[i]) &&
+            ((best < 0) || (prefixes[i].size() > prefixes[best].size())))
+            best = static_cast<int>(i);
+    }
+    return best;
+}
+
+void random_prefixes(std::uint64_t seed) {
+    wsframe::XorShift128Plus rng(seed, ~seed);
+    std::array<std::string, N> prefixes;
+    std::set<std::string> seen;
+    for (std::size_t i = 0; i < N;) {
+        std::string prefix = random_string(rng, MAX_LEN);
+        if (seen.insert(prefix).second)
+            prefixes[i++] = prefix;
+    }
+    std::array<std::string_view, N> views;
+    for (std::size_t i = 0; i < N; i++)
+        views[i] = prefixes[i];
+    wsframe::PrefixRouter<N, MAX_LEN> router(views);
+    CHECK(router.size() == N);
+
+    std::array<std::uint8_t, 4> key = {0x12, 0x34, 0x56, 0x78};
+    for (int i = 0; i < 20000; i++) {
+        std::string payload = random_string(rng, MAX_LEN + 4);
+        if (i % 2 == 0)
+            payload = prefixes[rng.next64() % N] + payload;
+        int expected = longest_prefix(prefixes, payload);
+        CHECK(router.route(payload) == expected);
+
+        std::string masked = payload;
+        wsframe::apply_mask(reinterpret_cast<std::uint8_t*>(masked.data()),
+                            reinterpret_cast<const std::uint8_t*>(
+                                payload.data()),
+                            payload.size(), key);
+        CHECK(router.route(masked, key) == expected);
+    }
+
+    bool threw = false;
+    try {
+        views[1] = views[0];
+        wsframe::PrefixRouter<N, MAX_LEN> duplicate(views);
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    CHECK(threw);
+}
+
+void parser_hooks() {
+    using Hooks = wsframe::RouteHooks<decltype(channel_router)>;
+    wsframe::BasicFrameParser<Hooks> parser{Hooks(channel_router)};
+    wsframe::FrameFactory factory;
+    struct Case {
+        wsframe::Frame::Opcode opcode;
+        bool mask;
+        std::string_view payload;
+        int route;
+    };
+    const Case cases[] = {
+        {wsframe::Frame::Opcode::TEXT, false, R"({"channel":"book.l2"})", 2},
+        {wsframe::Frame::Opcode::TEXT, true, R"({"channel":"trades"})", 0},
+        {wsframe::Frame::Opcode::BINARY, true, R"({"op":"sub"})", 3},
+        {wsframe::Frame::Opcode::TEXT, false, R"({"other":1})", -1},
+        // control frames are not routed
+        {wsframe::Frame::Opcode::PING, false, R"({"op":)", -1},
+    };
+    for (const Case& c : cases) {
+        auto frame =
+            parser.update(factory.construct(true, c.opcode, c.mask, c.payload));
+        CHECK(frame.has_value());
+        CHECK(parser.hooks().route() == c.route);
+    }
+}
+
+} // namespace
+
+int main() {
+    random_prefixes(1);
+    random_prefixes(2);
+    random_prefixes(3);
+    parser_hooks();
+    return 0;
+}
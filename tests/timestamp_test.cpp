@@ -0,0 +1,98 @@
+// Frame::first_byte_time/last_byte_time must be the arrival times of the
+// chunks holding the frame's first and last byte, for any chunking,
+// including frames far larger than the chunks they arrive in, whether the
+// frames are returned by update() or described by parse_batch().
+
+#include <wsframe/wsframe.hpp>
+
+#include <algorithm>
+#include <array>
+#include <string>
+#include <vector>
+
+#include "check.hpp"
+
+namespace {
+
+struct Expected {
+    std::size_t start;
+    std::size_t end;
+};
+
+void run(std::uint64_t seed, std::size_t max_chunk, bool batch) {
+    wsframe::XorShift128Plus rng(seed, ~seed);
+    wsframe::FrameFactory factory;
+    std::string payload(1 << 18, 'p');
+    std::string stream;
+    std::vector<Expected> frames;
+    for (int i = 0; i < 2000; i++) {
+        std::uint64_t pick = rng.next64();
+        std::size_t size = (pick % 50 == 0) ? (pick >> 8) % payload.size()
+                                            : (pick >> 8) % 300;
+        std::size_t start = stream.size();
+        std::string_view data = std::string_view(payload).substr(0, size);
+        stream.append(factory.binary(true, (pick >> 4) & 1, data));
+        frames.push_back({start, stream.size()});
+    }
+
+    // chunk c spans [chunk_ends[c - 1], chunk_ends[c]) and arrives at
+    // 1000 + c
+    std::vector<std::size_t> chunk_ends;
+    for (std::size_t at = 0; at < stream.size();) {
+        at = std::min(stream.size(), at + 1 + rng.next64() % max_chunk);
+        chunk_ends.push_back(at);
+    }
+    auto time_of = [&](std::size_t offset) {
+        auto c = std::upper_bound(chunk_ends.begin(), chunk_ends.end(), offset);
+        return 1000 + static_cast<std::size_t>(c - chunk_ends.begin());
+    };
+
+    wsframe::FrameParser parser;
+    std::size_t n = 0;
+    auto check = [&](std::uint64_t first, std::uint64_t last) {
+        CHECK(n < frames.size());
+        CHECK(first == time_of(frames[n].start));
+        CHECK(last == time_of(frames[n].end - 1));
+        n++;
+    };
+    std::array<wsframe::FrameDescriptor, 3> out;
+    std::array<wsframe::FrameTimes, 3> times;
+    std::size_t at = 0;
+    for (std::size_t c = 0; c < chunk_ends.size(); c++) {
+        std::string_view chunk =
+            std::string_view(stream).substr(at, chunk_ends[c] - at);
+        at = chunk_ends[c];
+        if (batch) {
+            std::size_t count = parser.parse_batch(chunk, 1000 + c, out.data(),
+                                                   out.size(), times.data());
+            while (count > 0) {
+                for (std::size_t i = 0; i < count; i++) {
+                    CHECK(out[i].length == frames[n].end - frames[n].start -
+                                               out[i].header_len);
+                    check(times[i].first_byte_time, times[i].last_byte_time);
+                }
+                count = parser.parse_batch({}, 1000 + c, out.data(),
+                                           out.size(), times.data());
+            }
+            continue;
+        }
+        auto frame = parser.update(chunk, 1000 + c);
+        while (frame) {
+            check(frame->first_byte_time, frame->last_byte_time);
+            frame = parser.update(false, 1000 + c);
+        }
+    }
+    CHECK(n == frames.size());
+}
+
+} // namespace
+
+int main() {
+    for (bool batch : {false, true}) {
+        run(1, 1, batch);
+        run(2, 7, batch);
+        run(3, 1460, batch);
+        run(4, 1 << 16, batch);
+    }
+    return 0;
+}
@@ -0,0 +1,170 @@
+// Generates synthetic WebSocket traffic into a file (see
+// wsframe/generator.hpp) and optionally the list of expected frames, as a
+// raw array of wsframe::ExpectedFrame.
+//
+//   ws_generate --bytes=N [--threads=N] [--seed=N] [--min-payload=N]
+//               [--max-payload=N] [--zipf=S] [--text=R] [--fragment=R]
+//               [--max-fragments=N] [--control=R] [--mask=R]
+//               [--expected=path] [--verify] output.ws
+//
+// Ratios are in [0, 1]. --verify parses the result with FrameParser and
+// checks every frame against the expected list.
+
+#include <wsframe/generator.hpp>
+#include <wsframe/mapped_file.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <string_view>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+void usage() {
+    std::cerr << "usage: ws_generate --bytes=N [--threads=N] [--seed=N] "
+                 "[--min-payload=N] [--max-payload=N] [--zipf=S] [--text=R] "
+                 "[--fragment=R] [--max-fragments=N] [--control=R] "
+                 "[--mask=R] [--expected=path] [--verify] output.ws"
+              << std::endl;
+}
+
+// value of `--name=value` if arg is that option
+bool option(std::string_view arg, std::string_view name, std::string& value) {
+    if ((arg.size() <= name.size() + 3) || (arg.substr(0, 2) != "--") ||
+        (arg.substr(2, name.size()) != name) || (arg[name.size() + 2] != '='))
+        return false;
+    value = std::string(arg.substr(name.size() + 3));
+    return true;
+}
+
+bool write_expected(const std::string& path,
+                    const std::vector<wsframe::ExpectedFrame>& expected) {
+    std::FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file)
+        return false;
+    std::size_t size = expected.size() * sizeof(wsframe::ExpectedFrame);
+    bool ok = std::fwrite(expected.data(), 1, size, file) == size;
+    return (std::fclose(file) == 0) && ok;
+}
+
+std::size_t verify(const std::string& path,
+                   const std::vector<wsframe::ExpectedFrame>& expected) {
+    wsframe::MappedFile file = wsframe::MappedFile::open(path);
+    std::string_view data(reinterpret_cast<const char*>(file.data()),
+                          file.size());
+    wsframe::FrameParser parser;
+    std::size_t frames = 0;
+    std::size_t errors = 0;
+    const std::size_t chunk = 64 * 1024;
+    for (std::size_t off = 0; off < data.size(); off += chunk) {
+        auto frame = parser.update(data.substr(off, chunk));
+        while (frame.has_value()) {
+            if ((frames >= expected.size()) ||
+                !expected[frames].matches(*frame)) {
+                if (errors++ < 10)
+                    std::cerr << "frame " << frames << " mismatch: " << *frame
+                              << std::endl;
+            }
+            frames++;
+            frame = parser.update(false);
+        }
+    }
+    if (frames != expected.size()) {
+        std::cerr << "parsed " << frames << " of " << expected.size()
+                  << " frames" << std::endl;
+        errors++;
+    }
+    return errors;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    wsframe::GeneratorConfig config;
+    std::size_t bytes = 0;
+    std::size_t threads = std::max(1U, std::thread::hardware_concurrency());
+    std::string output;
+    std::string expected_path;
+    bool check = false;
+    try {
+        for (int i = 1; i < argc; i++) {
+            std::string_view arg = argv[i];
+            std::string value;
+            if (option(arg, "bytes", value)) {
+                bytes = std::stoull(value);
+            } else if (option(arg, "threads", value)) {
+                threads = std::stoul(value);
+            } else if (option(arg, "seed", value)) {
+                config.seed = std::stoull(value);
+            } else if (option(arg, "min-payload", value)) {
+                config.min_payload = std::stoull(value);
+            } else if (option(arg, "max-payload", value)) {
+                config.max_payload = std::stoull(value);
+            } else if (option(arg, "zipf", value)) {
+                config.zipf_s = std::stod(value);
+            } else if (option(arg, "text", value)) {
+                config.text_ratio = std::stod(value);
+            } else if (option(arg, "fragment", value)) {
+                config.fragment_ratio = std::stod(value);
+            } else if (option(arg, "max-fragments", value)) {
+                config.max_fragments = std::stoul(value);
+            } else if (option(arg, "control", value)) {
+                config.control_ratio = std::stod(value);
+            } else if (option(arg, "mask", value)) {
+                config.mask_ratio = std::stod(value);
+            } else if (option(arg, "expected", value)) {
+                expected_path = value;
+            } else if (arg == "--verify") {
+                check = true;
+            } else if ((arg.substr(0, 2) != "--") && output.empty()) {
+                output = arg;
+            } else {
+                usage();
+                return 2;
+            }
+        }
+    } catch (const std::exception&) {
+        usage();
+        return 2;
+    }
+    if (output.empty() || (bytes == 0) ||
+        (config.min_payload > config.max_payload)) {
+        usage();
+        return 2;
+    }
+
+    try {
+        bool need_expected = check || !expected_path.empty();
+        std::vector<wsframe::ExpectedFrame> expected;
+        auto start = Clock::now();
+        std::size_t size = wsframe::generate_file(
+            config, bytes, threads, output,
+            need_expected ? &expected : nullptr);
+        double seconds =
+            std::chrono::duration<double>(Clock::now() - start).count();
+        std::cout << std::fixed << std::setprecision(3) << "wrote " << size
+                  << " bytes to " << output << " in " << seconds << " s ("
+                  << size / seconds / 1e9 << " GB/s, " << threads
+                  << " threads)" << std::endl;
+        if (need_expected)
+            std::cout << expected.size() << " frames" << std::endl;
+
+        if (!expected_path.empty() && !write_expected(expected_path, expected)) {
+            std::cerr << "failed to write " << expected_path << std::endl;
+            return 1;
+        }
+        if (check) {
+            std::size_t errors = verify(output, expected);
+            std::cout << "verify: " << (errors ? "FAILED" : "ok") << std::endl;
+            return errors ? 1 : 0;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
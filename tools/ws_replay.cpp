@@ -0,0 +1,698 @@
+// Replays recorded WebSocket traffic from a pcap file through FrameParser.
+//
+// The capture is mapped, TCP payload is reassembled per direction of every
+// flow, an HTTP upgrade at the start of a stream is skipped and the rest is
+// fed to one FrameParser per direction, in segment sized updates stamped
+// with the packet time. A FIN or RST closes the direction once the bytes
+// before it are in; a frame it cuts off is counted.
+//
+//   ws_replay [--timing=fast|original] [--speed=X] [--loops=N] [--flows]
+//             [--frames] capture.pcap
+//
+// --timing=fast (default) replays as fast as possible and reports
+// throughput. --timing=original paces packets by their capture timestamps
+// (scaled by --speed) and reports the latency of each update call that
+// completed frames.
+//
+// Classic pcap only (not pcapng), Ethernet, Linux cooked (SLL) or raw IP
+// link types, IPv4 and IPv6. IP fragments are not reassembled.
+
+#include <wsframe/mapped_file.hpp>
+#include <wsframe/wsframe.hpp>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr std::uint32_t PCAP_MAGIC_US = 0xa1b2c3d4;
+constexpr std::uint32_t PCAP_MAGIC_NS = 0xa1b23c4d;
+
+constexpr std::uint32_t LINKTYPE_ETHERNET = 1;
+constexpr std::uint32_t LINKTYPE_RAW = 101;
+constexpr std::uint32_t LINKTYPE_LINUX_SLL = 113;
+
+// segments buffered out of order before a stream is given up on
+constexpr std::size_t MAX_PENDING = 4096;
+
+std::uint16_t load_be16(const std::uint8_t* p) {
+    return static_cast<std::uint16_t>((p[0] << 8) | p[1]);
+}
+
+std::uint32_t load_be32(const std::uint8_t* p) {
+    return (std::uint32_t(p[0]) << 24) | (std::uint32_t(p[1]) << 16) |
+           (std::uint32_t(p[2]) << 8) | p[3];
+}
+
+// seq a before seq b, modulo 2^32
+bool seq_before(std::uint32_t a, std::uint32_t b) {
+    return static_cast<std::int32_t>(a - b) < 0;
+}
+
+struct Packet {
+    // nanoseconds since the epoch
+    std::uint64_t time;
+    const std::uint8_t* data;
+    std::size_t caplen;
+    std::size_t len;
+};
+
+class PcapReader {
+  private:
+    wsframe::MappedFile m_file;
+    bool m_swapped = false;
+    bool m_nanos = false;
+    std::uint32_t m_linktype = 0;
+    std::size_t m_offset = 24;
+
+    std::uint32_t load32(const std::uint8_t* p) const {
+        std::uint32_t v;
+        std::memcpy(&v, p, 4);
+        return m_swapped ? __builtin_bswap32(v) : v;
+    }
+
+  public:
+    PcapReader(const std::string& path)
+        : m_file(wsframe::MappedFile::open(path)) {
+        if (m_file.size() < 24)
+            throw std::runtime_error("Not a pcap file: " + path);
+        std::uint32_t magic;
+        std::memcpy(&magic, m_file.data(), 4);
+        if ((magic == PCAP_MAGIC_US) || (magic == PCAP_MAGIC_NS)) {
+            m_nanos = magic == PCAP_MAGIC_NS;
+        } else if ((__builtin_bswap32(magic) == PCAP_MAGIC_US) ||
+                   (__builtin_bswap32(magic) == PCAP_MAGIC_NS)) {
+            m_swapped = true;
+            m_nanos = __builtin_bswap32(magic) == PCAP_MAGIC_NS;
+        } else {
+            throw std::runtime_error("Not a pcap file (pcapng is not "
+                                     "supported): " +
+                                     path);
+        }
+        m_linktype = load32(m_file.data() + 20) & 0x0FFFFFFF;
+        m_file.advise_sequential();
+    }
+
+    std::uint32_t linktype() const { return m_linktype; }
+
+    std::size_t size() const { return m_file.size(); }
+
+    void rewind() { m_offset = 24; }
+
+    bool next(Packet& out) {
+        if (m_offset + 16 > m_file.size())
+            return false;
+        const std::uint8_t* header = m_file.data() + m_offset;
+        std::uint64_t sec = load32(header);
+        std::uint64_t frac = load32(header + 4);
+        std::size_t caplen = load32(header + 8);
+        if (m_offset + 16 + caplen > m_file.size())
+            return false;
+        out.time = sec * 1000000000ULL + (m_nanos ? frac : frac * 1000);
+        out.data = header + 16;
+        out.caplen = caplen;
+        out.len = load32(header + 12);
+        m_offset += 16 + caplen;
+        return true;
+    }
+};
+
+// one direction of a TCP connection
+struct FlowKey {
+    std::array<std::uint8_t, 16> src{};
+    std::array<std::uint8_t, 16> dst{};
+    std::uint16_t src_port = 0;
+    std::uint16_t dst_port = 0;
+    bool v6 = false;
+
+    bool operator==(const FlowKey& other) const {
+        return (src == other.src) && (dst == other.dst) &&
+               (src_port == other.src_port) && (dst_port == other.dst_port) &&
+               (v6 == other.v6);
+    }
+
+    std::string to_string() const {
+        auto addr = [this](const std::array<std::uint8_t, 16>& a) {
+            char buf[64];
+            if (!v6) {
+                std::snprintf(buf, sizeof(buf), "%u.%u.%u.%u", a[0], a[1],
+                              a[2], a[3]);
+            } else {
+                int n = 0;
+                for (int i = 0; i < 16; i += 2) {
+                    n += std::snprintf(buf + n, sizeof(buf) - n, "%s%x",
+                                       i ? ":" : "", load_be16(&a[i]));
+                }
+                return "[" + std::string(buf) + "]";
+            }
+            return std::string(buf);
+        };
+        return addr(src) + ":" + std::to_string(src_port) + " > " + addr(dst) +
+               ":" + std::to_string(dst_port);
+    }
+};
+
+struct FlowKeyHash {
+    std::size_t operator()(const FlowKey& key) const {
+        std::uint64_t h = 1469598103934665603ULL;
+        auto mix = [&h](const std::uint8_t* p, std::size_t n) {
+            for (std::size_t i = 0; i < n; i++) {
+                h = (h ^ p[i]) * 1099511628211ULL;
+            }
+        };
+        mix(key.src.data(), 16);
+        mix(key.dst.data(), 16);
+        mix(reinterpret_cast<const std::uint8_t*>(&key.src_port), 2);
+        mix(reinterpret_cast<const std::uint8_t*>(&key.dst_port), 2);
+        return static_cast<std::size_t>(h);
+    }
+};
+
+struct Segment {
+    FlowKey key;
+    std::uint32_t seq;
+    bool syn;
+    bool fin_or_rst;
+    const std::uint8_t* payload;
+    std::size_t size;
+};
+
+// Link, IP and TCP headers; false for anything that is not a TCP segment
+bool decode(std::uint32_t linktype, const Packet& packet, Segment& out) {
+    const std::uint8_t* p = packet.data;
+    const std::uint8_t* end = packet.data + packet.caplen;
+    std::uint16_t ethertype;
+    switch (linktype) {
+    case LINKTYPE_ETHERNET:
+        if (end - p < 14)
+            return false;
+        ethertype = load_be16(p + 12);
+        p += 14;
+        while ((ethertype == 0x8100) || (ethertype == 0x88A8)) {
+            if (end - p < 4)
+                return false;
+            ethertype = load_be16(p + 2);
+            p += 4;
+        }
+        break;
+    case LINKTYPE_LINUX_SLL:
+        if (end - p < 16)
+            return false;
+        ethertype = load_be16(p + 14);
+        p += 16;
+        break;
+    case LINKTYPE_RAW:
+        if (end - p < 1)
+            return false;
+        ethertype = ((p[0] >> 4) == 6) ? 0x86DD : 0x0800;
+        break;
+    default:
+        return false;
+    }
+
+    out.key = FlowKey();
+    const std::uint8_t* ip_end;
+    if (ethertype == 0x0800) {
+        if ((end - p < 20) || ((p[0] >> 4) != 4))
+            return false;
+        std::size_t ihl = (p[0] & 0x0F) * 4;
+        std::size_t total = load_be16(p + 2);
+        // fragments (MF set or non-zero offset) are not reassembled
+        if ((load_be16(p + 6) & 0x3FFF) || (p[9] != 6) || (ihl < 20))
+            return false;
+        std::memcpy(out.key.src.data(), p + 12, 4);
+        std::memcpy(out.key.dst.data(), p + 16, 4);
+        ip_end = p + total;
+        p += ihl;
+    } else if (ethertype == 0x86DD) {
+        if ((end - p < 40) || ((p[0] >> 4) != 6))
+            return false;
+        out.key.v6 = true;
+        std::memcpy(out.key.src.data(), p + 8, 16);
+        std::memcpy(out.key.dst.data(), p + 24, 16);
+        ip_end = p + 40 + load_be16(p + 4);
+        std::uint8_t next = p[6];
+        p += 40;
+        // hop-by-hop, routing and destination options
+        while ((next == 0) || (next == 43) || (next == 60)) {
+            if (end - p < 8)
+                return false;
+            next = p[0];
+            p += (p[1] + 1) * 8;
+        }
+        if (next != 6)
+            return false;
+    } else {
+        return false;
+    }
+    // ethernet padding and truncated snaplen
+    ip_end = std::min(ip_end, end);
+    if (ip_end - p < 20)
+        return false;
+    std::size_t data_offset = (p[12] >> 4) * 4;
+    if ((data_offset < 20) || (ip_end - p < static_cast<long>(data_offset)))
+        return false;
+    out.key.src_port = load_be16(p);
+    out.key.dst_port = load_be16(p + 2);
+    out.seq = load_be32(p + 4);
+    out.syn = p[13] & 0x02;
+    out.fin_or_rst = p[13] & 0x05;
+    out.payload = p + data_offset;
+    out.size = static_cast<std::size_t>(ip_end - out.payload);
+    return true;
+}
+
+struct Options {
+    bool original_timing = false;
+    double speed = 1.0;
+    std::size_t loops = 1;
+    bool print_flows = false;
+    bool print_frames = false;
+    std::string path;
+};
+
+struct Totals {
+    std::uint64_t packets = 0;
+    std::uint64_t segments = 0;
+    std::uint64_t stream_bytes = 0;
+    std::uint64_t frame_bytes = 0;
+    std::uint64_t frames = 0;
+    std::uint64_t retransmitted_bytes = 0;
+    std::uint64_t truncated = 0;
+    std::uint64_t lost_streams = 0;
+    // streams closed by FIN/RST in the middle of a frame
+    std::uint64_t incomplete_frames = 0;
+};
+
+class Stream {
+  public:
+    enum class State { HANDSHAKE, FRAMES, LOST, CLOSED };
+
+  private:
+    FlowKey m_key;
+    State m_state = State::HANDSHAKE;
+    bool m_synced = false;
+    std::uint32_t m_next_seq = 0;
+    std::map<std::uint32_t, std::string> m_pending;
+    std::string m_handshake;
+    wsframe::FrameParser m_parser;
+    std::uint64_t m_frames = 0;
+    std::uint64_t m_frame_bytes = 0;
+    std::uint64_t m_bytes = 0;
+    // FIN or RST seen: the stream ends once the bytes before m_end_seq are in
+    bool m_closing = false;
+    std::uint32_t m_end_seq = 0;
+
+    void close(Totals& totals) {
+        if ((m_state == State::FRAMES) &&
+            (m_parser.peek_header() || (m_parser.frame_buffer().size() > 0)))
+            totals.incomplete_frames++;
+        m_state = State::CLOSED;
+        m_closing = false;
+        m_pending.clear();
+        m_handshake.clear();
+        m_handshake.shrink_to_fit();
+        // release the parser's buffers
+        m_parser = wsframe::FrameParser();
+    }
+
+    // a new connection on the same addresses and ports
+    void reopen() {
+        m_state = State::HANDSHAKE;
+        m_synced = false;
+    }
+
+    template <typename OnFrame>
+    void frames(std::string_view data, std::uint64_t time, OnFrame& on_frame) {
+        auto frame = m_parser.update(data, time);
+        while (frame.has_value()) {
+            m_frames++;
+            m_frame_bytes += frame->payload.size();
+            on_frame(*this, *frame);
+            frame = m_parser.update(false);
+        }
+    }
+
+    // in order stream bytes
+    template <typename OnFrame>
+    void deliver(std::string_view data, std::uint64_t time,
+                 OnFrame& on_frame) {
+        m_bytes += data.size();
+        if (m_state == State::FRAMES) {
+            frames(data, time, on_frame);
+            return;
+        }
+        if (m_handshake.empty() && (data.substr(0, 4) != "GET ") &&
+            (data.substr(0, 5) != "HTTP/")) {
+            // capture started after the upgrade
+            m_state = State::FRAMES;
+            frames(data, time, on_frame);
+            return;
+        }
+        m_handshake.append(data);
+        auto end = m_handshake.find("\r\n\r\n");
+        if (end == std::string::npos)
+            return;
+        m_state = State::FRAMES;
+        std::string rest = m_handshake.substr(end + 4);
+        m_handshake.clear();
+        m_handshake.shrink_to_fit();
+        if (!rest.empty())
+            frames(rest, time, on_frame);
+    }
+
+  public:
+    Stream(const FlowKey& key) : m_key(key) {}
+
+    const FlowKey& key() const { return m_key; }
+    State state() const { return m_state; }
+    std::uint64_t frame_count() const { return m_frames; }
+    std::uint64_t frame_bytes() const { return m_frame_bytes; }
+    std::uint64_t bytes() const { return m_bytes; }
+
+    template <typename OnFrame>
+    void add(const Segment& segment, std::uint64_t time, Totals& totals,
+             OnFrame& on_frame) {
+        if ((m_state == State::CLOSED) && segment.syn)
+            reopen();
+        if ((m_state == State::LOST) || (m_state == State::CLOSED))
+            return;
+        std::uint32_t seq = segment.seq;
+        if (segment.syn) {
+            m_synced = true;
+            m_next_seq = seq + 1;
+            return;
+        }
+        if (!m_synced) {
+            // joined mid connection
+            m_synced = true;
+            m_next_seq = seq;
+        }
+        if (segment.fin_or_rst) {
+            m_closing = true;
+            m_end_seq = seq + static_cast<std::uint32_t>(segment.size);
+        }
+        receive(segment, time, totals, on_frame);
+        if (m_closing && (m_state != State::LOST) &&
+            !seq_before(m_next_seq, m_end_seq))
+            close(totals);
+    }
+
+  private:
+    template <typename OnFrame>
+    void receive(const Segment& segment, std::uint64_t time, Totals& totals,
+                 OnFrame& on_frame) {
+        if (segment.size == 0)
+            return;
+        std::uint32_t seq = segment.seq;
+        std::string_view data(reinterpret_cast<const char*>(segment.payload),
+                              segment.size);
+        if (seq_before(seq, m_next_seq)) {
+            std::uint32_t seen = m_next_seq - seq;
+            if (seen >= data.size()) {
+                totals.retransmitted_bytes += data.size();
+                return;
+            }
+            totals.retransmitted_bytes += seen;
+            data.remove_prefix(seen);
+            seq = m_next_seq;
+        }
+        if (seq != m_next_seq) {
+            if (m_pending.size() >= MAX_PENDING) {
+                m_state = State::LOST;
+                m_pending.clear();
+                totals.lost_streams++;
+                return;
+            }
+            auto& slot = m_pending[seq];
+            if (slot.size() < data.size())
+                slot.assign(data);
+            return;
+        }
+        deliver(data, time, on_frame);
+        m_next_seq += static_cast<std::uint32_t>(data.size());
+        // drain segments that are now in order
+        while (!m_pending.empty()) {
+            auto it = m_pending.begin();
+            std::uint32_t pending_seq = it->first;
+            if (seq_before(m_next_seq, pending_seq))
+                break;
+            std::string_view pending(it->second);
+            std::uint32_t seen = m_next_seq - pending_seq;
+            if (seen < pending.size()) {
+                pending.remove_prefix(seen);
+                deliver(pending, time, on_frame);
+                m_next_seq += static_cast<std::uint32_t>(pending.size());
+            }
+            m_pending.erase(it);
+        }
+    }
+};
+
+class Replay {
+  private:
+    const Options& m_options;
+    std::unordered_map<FlowKey, std::unique_ptr<Stream>, FlowKeyHash>
+        m_streams;
+    Totals m_totals;
+
+    Stream& stream(const FlowKey& key) {
+        auto& slot = m_streams[key];
+        if (!slot)
+            slot = std::make_unique<Stream>(key);
+        return *slot;
+    }
+
+  public:
+    Replay(const Options& options) : m_options(options) {}
+
+    const Totals& totals() const { return m_totals; }
+
+    template <typename OnFrame>
+    void packet(std::uint32_t linktype, const Packet& packet,
+                OnFrame& on_frame) {
+        m_totals.packets++;
+        Segment segment;
+        if (!decode(linktype, packet, segment))
+            return;
+        if (packet.caplen < packet.len)
+            m_totals.truncated++;
+        m_totals.segments++;
+        stream(segment.key).add(segment, packet.time, m_totals, on_frame);
+    }
+
+    void finish() {
+        for (auto& [key, stream] : m_streams) {
+            m_totals.stream_bytes += stream->bytes();
+            m_totals.frames += stream->frame_count();
+            m_totals.frame_bytes += stream->frame_bytes();
+        }
+    }
+
+    void print_flows(std::ostream& out) const {
+        std::vector<const Stream*> sorted;
+        for (auto& [key, stream] : m_streams) {
+            sorted.push_back(stream.get());
+        }
+        std::sort(sorted.begin(), sorted.end(),
+                  [](const Stream* a, const Stream* b) {
+                      return a->bytes() > b->bytes();
+                  });
+        for (const Stream* s : sorted) {
+            const char* state = s->state() == Stream::State::LOST ? " (lost)"
+                                : s->state() == Stream::State::HANDSHAKE
+                                    ? " (no upgrade)"
+                                : s->state() == Stream::State::CLOSED
+                                    ? " (closed)"
+                                    : "";
+            out << s->key().to_string() << state << ": " << s->bytes()
+                << " bytes, " << s->frame_count() << " frames" << std::endl;
+        }
+    }
+};
+
+std::uint64_t percentile(std::vector<std::uint64_t>& sorted, double p) {
+    if (sorted.empty())
+        return 0;
+    auto idx = static_cast<std::size_t>(p / 100.0 * (sorted.size() - 1));
+    return sorted[idx];
+}
+
+void print_totals(const Totals& totals) {
+    std::cout << "packets:         " << totals.packets << std::endl
+              << "tcp segments:    " << totals.segments << std::endl
+              << "stream bytes:    " << totals.stream_bytes << std::endl
+              << "frames:          " << totals.frames << std::endl
+              << "payload bytes:   " << totals.frame_bytes << std::endl;
+    if (totals.retransmitted_bytes)
+        std::cout << "retransmitted:   " << totals.retransmitted_bytes
+                  << " bytes" << std::endl;
+    if (totals.truncated)
+        std::cout << "truncated:       " << totals.truncated << " packets"
+                  << std::endl;
+    if (totals.lost_streams)
+        std::cout << "lost streams:    " << totals.lost_streams << std::endl;
+    if (totals.incomplete_frames)
+        std::cout << "cut off frames:  " << totals.incomplete_frames
+                  << " (FIN/RST in the middle of a frame)" << std::endl;
+}
+
+int run_fast(const Options& options, PcapReader& pcap) {
+    Totals sum;
+    std::uint64_t frames = 0;
+    auto on_frame = [&](const Stream& stream, const wsframe::Frame& frame) {
+        frames++;
+        if (options.print_frames)
+            std::cout << stream.key().to_string() << " " << frame << std::endl;
+    };
+    std::unique_ptr<Replay> last;
+    auto start = Clock::now();
+    for (std::size_t loop = 0; loop < options.loops; loop++) {
+        auto replay = std::make_unique<Replay>(options);
+        pcap.rewind();
+        Packet packet;
+        while (pcap.next(packet)) {
+            replay->packet(pcap.linktype(), packet, on_frame);
+        }
+        replay->finish();
+        last = std::move(replay);
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    print_totals(last->totals());
+    if (options.print_flows)
+        last->print_flows(std::cout);
+    double bytes = static_cast<double>(last->totals().stream_bytes) *
+                   options.loops;
+    std::cout << std::fixed << std::setprecision(3)
+              << "elapsed:         " << seconds << " s (" << options.loops
+              << " loops)" << std::endl
+              << "throughput:      " << bytes / seconds / 1e9 << " GB/s stream, "
+              << frames / seconds / 1e6 << " M frames/s, "
+              << static_cast<double>(pcap.size()) * options.loops / seconds /
+                     1e9
+              << " GB/s pcap" << std::endl;
+    return 0;
+}
+
+int run_original(const Options& options, PcapReader& pcap) {
+    // parse time of update calls that completed at least one frame
+    std::vector<std::uint64_t> latencies;
+    std::uint64_t max_lag = 0;
+    Clock::time_point call_start;
+    bool timed = false;
+    auto on_frame = [&](const Stream& stream, const wsframe::Frame& frame) {
+        if (!timed) {
+            latencies.push_back(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    Clock::now() - call_start)
+                    .count());
+            timed = true;
+        }
+        if (options.print_frames)
+            std::cout << stream.key().to_string() << " " << frame << std::endl;
+    };
+
+    Replay replay(options);
+    Packet packet;
+    bool first = true;
+    std::uint64_t first_time = 0;
+    Clock::time_point start;
+    while (pcap.next(packet)) {
+        if (first) {
+            first = false;
+            first_time = packet.time;
+            start = Clock::now();
+        }
+        auto due = start + std::chrono::nanoseconds(static_cast<std::int64_t>(
+                               (packet.time - first_time) / options.speed));
+        std::this_thread::sleep_until(due);
+        auto now = Clock::now();
+        max_lag = std::max<std::uint64_t>(
+            max_lag,
+            std::chrono::duration_cast<std::chrono::nanoseconds>(now - due)
+                .count());
+        call_start = now;
+        timed = false;
+        replay.packet(pcap.linktype(), packet, on_frame);
+    }
+    replay.finish();
+
+    print_totals(replay.totals());
+    if (options.print_flows)
+        replay.print_flows(std::cout);
+    std::sort(latencies.begin(), latencies.end());
+    std::cout << "parse latency:   p50 " << percentile(latencies, 50)
+              << " ns, p99 " << percentile(latencies, 99) << " ns, p99.9 "
+              << percentile(latencies, 99.9) << " ns, max "
+              << (latencies.empty() ? 0 : latencies.back()) << " ns ("
+              << latencies.size() << " samples)" << std::endl
+              << "max pacing lag:  " << max_lag << " ns" << std::endl;
+    return 0;
+}
+
+void usage() {
+    std::cerr << "usage: ws_replay [--timing=fast|original] [--speed=X] "
+                 "[--loops=N] [--flows] [--frames] capture.pcap"
+              << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        std::string_view arg = argv[i];
+        if (arg == "--timing=fast") {
+            options.original_timing = false;
+        } else if (arg == "--timing=original") {
+            options.original_timing = true;
+        } else if (arg.substr(0, 8) == "--speed=") {
+            options.speed = std::stod(std::string(arg.substr(8)));
+        } else if (arg.substr(0, 8) == "--loops=") {
+            options.loops = std::stoul(std::string(arg.substr(8)));
+        } else if (arg == "--flows") {
+            options.print_flows = true;
+        } else if (arg == "--frames") {
+            options.print_frames = true;
+        } else if ((arg.substr(0, 2) != "--") && options.path.empty()) {
+            options.path = arg;
+        } else {
+            usage();
+            return 2;
+        }
+    }
+    if (options.path.empty() || (options.speed <= 0) || (options.loops == 0)) {
+        usage();
+        return 2;
+    }
+    try {
+        PcapReader pcap(options.path);
+        if ((pcap.linktype() != LINKTYPE_ETHERNET) &&
+            (pcap.linktype() != LINKTYPE_RAW) &&
+            (pcap.linktype() != LINKTYPE_LINUX_SLL)) {
+            std::cerr << "unsupported link type " << pcap.linktype()
+                      << std::endl;
+            return 1;
+        }
+        return options.original_timing ? run_original(options, pcap)
+                                       : run_fast(options, pcap);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+}